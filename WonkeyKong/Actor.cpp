@@ -10,26 +10,51 @@ Actor::Actor(int imageID,
              StudentWorld* world,
              int startDirection)
 :
-GraphObject(imageID, startX, startY, startDirection),
+GraphObject(world->graphObjects(), imageID, startX, startY, startDirection),
 m_world(world),
-m_dead(false)
+m_traits(actorTraits(imageID)),
+m_dead(false),
+m_dormant(hasTrait(TRAIT_DORMANT)),
+m_waiting(false),
+m_onAwakeList(false),
+m_thinkInterval(1),
+m_thinkPhase(0),
+m_spawnOrder(0),
+m_serial(0),
+m_timerTick(-1),
+m_timerIndex(0),
+m_groupIndex(0),
+m_awakeList(nullptr)
 {}
 
-// Floor Implementation
-Floor::Floor(int startX,
-             int startY,
-             StudentWorld* world)
-:
-Actor(IID_FLOOR, startX, startY, world)
-{}
+void Actor::setDead()
+{
+    m_dead = true;
+    m_dormant = false;
+    m_waiting = false;
+    m_thinkInterval = 1;
+    relist();
+}
 
-// Ladder Implementation
-Ladder::Ladder(int startX,
-               int startY,
-               StudentWorld* world)
-:
-Actor(IID_LADDER, startX, startY, world)
-{}
+void Actor::moved(int fromX, int fromY) {m_world->relocate(this, fromX, fromY);}
+
+void Actor::saveState(ActorState& state) const
+{
+    state.x = getX();
+    state.y = getY();
+    state.direction = getDirection();
+    state.animationNumber = getAnimationNumber();
+    state.dead = m_dead;
+    state.serial = m_serial;
+    state.counters[0] = state.counters[1] = state.counters[2] = 0;
+}
+
+void Actor::loadState(const ActorState& state)
+{
+    restoreState(state.x, state.y, state.direction, state.animationNumber);
+    m_dead = state.dead;
+    m_serial = state.serial;
+}
 
 // Player Implementation
 Player::Player(int startX,
@@ -93,7 +118,7 @@ void Player::doSomething()
     }
     
     int ch;
-    if (world()->getKey(ch))
+    if (world()->readKey(ch))
     {
         switch (ch)
         {
@@ -152,6 +177,22 @@ void Player::doSomething()
     }
 }
 
+void Player::saveState(ActorState& state) const
+{
+    Actor::saveState(state);
+    state.counters[0] = m_burps;
+    state.counters[1] = m_freezeTimer;
+    state.counters[2] = m_jumpSequence;
+}
+
+void Player::loadState(const ActorState& state)
+{
+    Actor::loadState(state);
+    m_burps = state.counters[0];
+    m_freezeTimer = state.counters[1];
+    m_jumpSequence = state.counters[2];
+}
+
 // Bonfire Implementation
 Bonfire::Bonfire(int startX,
                  int startY,
@@ -177,17 +218,12 @@ Goodie::Goodie(int imageID,
 
 void Goodie::incScore() {world()->increaseScore(m_scoreWorth);}
 
-void Goodie::doSomething()
+void Goodie::contactPlayer()
 {
-    Actor::doSomething();
-    
-    if (world()->isAt(world()->player(), getX(), getY()))
-    {
-        incScore();
-        buff();
-        world()->playSound(SOUND_GOT_GOODIE);
-        setDead();
-    }
+    incScore();
+    buff();
+    world()->playSound(SOUND_GOT_GOODIE);
+    setDead();
 }
 
 // ExtraLifeGoodie Implementation
@@ -217,9 +253,9 @@ Enemy::Enemy(int imageID,
              StudentWorld* world)
 :
 Actor(imageID, startX, startY, world),
-m_countDown(0)
+m_nextMove(0)
 {
-    int i = randInt(0,1);
+    int i = world->randInt(0,1);
     switch (i)
     {
         case 0:
@@ -241,26 +277,35 @@ bool Enemy::Attack()
     return false;
 }
 
+// The player is checked for in the cell the enemy starts its turn in and,
+// if it moves, in the cell it ends up in, so walking into an enemy that
+// then moves away or swaps cells with the player still counts as a hit
 void Enemy::doSomething()
 {
     Actor::doSomething();
-    if (Attack()) return;
-    EnemyOnly();
+    long long now = world()->tick();
     
-    if (m_countDown % 10 == 0)
+    // An attack holds up the next move by a tick
+    if (Attack())
+        m_nextMove = std::max(m_nextMove, now) + 1;
+    else
     {
-        m_countDown = 0;
-        specialMove();
-        if (Attack()) return;
+        EnemyOnly();
+        if (now >= m_nextMove)
+        {
+            specialMove();
+            m_nextMove = now + (Attack() ? 1 : 10);
+        }
     }
     
-    m_countDown++;
+    // Nothing happens in between unless the player walks in, which wakes us early
+    world()->sleepUntil(this, nextThinkTick());
 }
 
 void Enemy::reverseOrGo(int x, int y)
 {
     getPositionInThisDirection(getDirection(), 1, x, y);
-    if (world()->isBlocked(x, y) || world()->freeFall(x, y))
+    if (!world()->isWalkable(x, y))
     {
         setDirection(reverseHelper(getDirection()));
     }
@@ -276,6 +321,18 @@ void Enemy::setDead()
     Actor::setDead();
 }
 
+void Enemy::saveState(ActorState& state) const
+{
+    Actor::saveState(state);
+    state.counters[0] = m_nextMove;
+}
+
+void Enemy::loadState(const ActorState& state)
+{
+    Actor::loadState(state);
+    m_nextMove = state.counters[0];
+}
+
 // Fireball Implementation
 Fireball::Fireball(int startX,
                    int startY,
@@ -291,7 +348,7 @@ void Fireball::specialMove()
     
     if (world()->canClimb(getX(), getY()) && !world()->isBlocked(getX(), getY() + 1) && m_climbState != down)
     {
-        int r = randInt(1,3);
+        int r = world()->randInt(1,3);
         if (m_climbState == up || r == 1)
         {
             m_climbState = up;
@@ -301,7 +358,7 @@ void Fireball::specialMove()
     }
     if (world()->canClimb(getX(), getY() - 1) && m_climbState != up)
     {
-        int r = randInt(1, 3);
+        int r = world()->randInt(1, 3);
         if (m_climbState == down || r == 1)
          {
              m_climbState = down;
@@ -325,20 +382,35 @@ void Fireball::specialMove()
     }
 }
 
+void Fireball::saveState(ActorState& state) const
+{
+    Enemy::saveState(state);
+    state.counters[1] = m_climbState;
+}
+
+void Fireball::loadState(const ActorState& state)
+{
+    Enemy::loadState(state);
+    m_climbState = state.counters[1];
+}
+
 // Koopa Implementation
 Koopa::Koopa(int startX,
              int startY,
              StudentWorld* world)
 :
 Enemy(IID_KOOPA, startX, startY, world),
-m_freezeCD(0)
+m_freezeEnd(0),
+m_cooledThrough(-1)
 {}
 
 bool Koopa::Attack()
 {
-    if (world()->isAt(world()->player(), getX(), getY()) && m_freezeCD == 0)
+    // Each tick's cooldown step comes between its two attack checks
+    long long now = world()->tick();
+    if (world()->isAt(world()->player(), getX(), getY()) && std::max(m_cooledThrough, now - 1) >= m_freezeEnd)
     {
-        m_freezeCD +=50;
+        m_freezeEnd = now + 50;
         world()->player()->frozen();
         return true;
     }
@@ -350,12 +422,29 @@ void Koopa::specialMove()
     reverseOrGo(getX(), getY());
 }
 
-void Koopa::EnemyOnly()
+void Koopa::EnemyOnly() {m_cooledThrough = world()->tick();}
+
+long long Koopa::nextThinkTick() const
 {
-    if (m_freezeCD > 0)
-    {
-        m_freezeCD--;
-    }
+    // Wake when the cooldown runs out too, in case the player is still here
+    long long next = Enemy::nextThinkTick();
+    if (m_freezeEnd + 1 > world()->tick())
+        next = std::min(next, m_freezeEnd + 1);
+    return next;
+}
+
+void Koopa::saveState(ActorState& state) const
+{
+    Enemy::saveState(state);
+    state.counters[1] = m_freezeEnd;
+    state.counters[2] = m_cooledThrough;
+}
+
+void Koopa::loadState(const ActorState& state)
+{
+    Enemy::loadState(state);
+    m_freezeEnd = state.counters[1];
+    m_cooledThrough = state.counters[2];
 }
 
 // Barrel Implementation
@@ -384,6 +473,14 @@ void Barrel::EnemyOnly()
         
 }
 
+long long Barrel::nextThinkTick() const
+{
+    // Falling, or about to land and turn round: every tick
+    if (m_fallen || !world()->isBlocked(getX(), getY() - 1))
+        return world()->tick() + 1;
+    return Enemy::nextThinkTick();
+}
+
 void Barrel::specialMove()
 {
     int x = 0, y = 0;
@@ -392,6 +489,18 @@ void Barrel::specialMove()
     else moveTo(x, y);
 }
 
+void Barrel::saveState(ActorState& state) const
+{
+    Enemy::saveState(state);
+    state.counters[1] = m_fallen;
+}
+
+void Barrel::loadState(const ActorState& state)
+{
+    Enemy::loadState(state);
+    m_fallen = state.counters[1] != 0;
+}
+
 // Kong Implementation
 Kong::Kong(int startX,
            int startY,
@@ -437,7 +546,7 @@ void Kong::doSomething()
         m_countDown = 0;
         if (m_flee)
         {
-            if (getY() + 1 == VIEW_HEIGHT)
+            if (getY() + 1 == world()->boardHeight())
             {
                 world()->win();
             }
@@ -448,6 +557,22 @@ void Kong::doSomething()
     m_countDown++;
 }
 
+void Kong::saveState(ActorState& state) const
+{
+    Actor::saveState(state);
+    state.counters[0] = m_flee;
+    state.counters[1] = m_countDown;
+    state.counters[2] = m_ticksElapsed;
+}
+
+void Kong::loadState(const ActorState& state)
+{
+    Actor::loadState(state);
+    m_flee = state.counters[0] != 0;
+    m_countDown = state.counters[1];
+    m_ticksElapsed = state.counters[2];
+}
+
 // Burp Implementation
 Burp::Burp(int startX,
            int startY,
@@ -470,5 +595,16 @@ void Burp::doSomething()
     }
     
     world()->attackAt(getX(), getY());
-    
+}
+
+void Burp::saveState(ActorState& state) const
+{
+    Actor::saveState(state);
+    state.counters[0] = m_life;
+}
+
+void Burp::loadState(const ActorState& state)
+{
+    Actor::loadState(state);
+    m_life = state.counters[0];
 }
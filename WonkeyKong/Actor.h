@@ -2,9 +2,54 @@
 #define ACTOR_H_
 
 #include "GraphObject.h"
+#include <vector>
 
 class StudentWorld;
 
+// Actor traits
+// Answers that are fixed per actor type, packed into a bitmask indexed by
+// image ID. Each actor copies its entry at construction so the world's cell
+// queries filter candidates with a mask test instead of a virtual call.
+const unsigned int TRAIT_FLAMMABLE = 1 << 0;        // killed by bonfires
+const unsigned int TRAIT_ENEMY = 1 << 1;            // killed by burps, hurts the player
+const unsigned int TRAIT_DROPS_EXTRA_LIFE = 1 << 2; // may leave an extra life goodie when killed
+const unsigned int TRAIT_DROPS_GARLIC = 1 << 3;     // may leave a garlic goodie when killed
+const unsigned int TRAIT_DORMANT = 1 << 4;          // never needs a turn of its own
+
+constexpr unsigned char ACTOR_TRAITS[] =
+{
+    0,                                      // IID_PLAYER
+    0,                                      // IID_KONG
+    TRAIT_FLAMMABLE | TRAIT_ENEMY,          // IID_BARREL
+    TRAIT_ENEMY | TRAIT_DROPS_GARLIC,       // IID_FIREBALL
+    TRAIT_ENEMY | TRAIT_DROPS_EXTRA_LIFE,   // IID_KOOPA
+    0,                                      // IID_FLOOR
+    0,                                      // IID_LADDER
+    TRAIT_DORMANT,                          // IID_EXTRA_LIFE_GOODIE
+    TRAIT_DORMANT,                          // IID_GARLIC_GOODIE
+    0,                                      // IID_BONFIRE
+    0,                                      // IID_BURP
+};
+
+constexpr unsigned int actorTraits(int imageID)
+{
+    return imageID >= 0 && imageID < static_cast<int>(sizeof(ACTOR_TRAITS)) ? ACTOR_TRAITS[imageID] : 0;
+}
+
+// Actor state
+// Everything needed to put an actor back exactly as it was. The meaning of
+// counters[] depends on the actor type; see each class's saveState().
+struct ActorState
+{
+    int x;
+    int y;
+    int direction;
+    unsigned int animationNumber;
+    bool dead;
+    unsigned int serial;
+    long long counters[3];
+};
+
 // Actor
 class Actor : public GraphObject
 {
@@ -16,45 +61,114 @@ public:
           int startDirection=none);
     ~Actor() {}
     StudentWorld* world() const {return m_world;}
-    virtual bool isObstacle() const {return false;}
-    virtual bool canClimb() const {return false;}
-    virtual bool fireProof() const {return true;}
-    virtual bool isEnemy() const {return false;}
+    unsigned int traits() const {return m_traits;}
+    bool hasTrait(unsigned int mask) const {return (m_traits & mask) != 0;}
+    bool fireProof() const {return !hasTrait(TRAIT_FLAMMABLE);}
+    bool isEnemy() const {return hasTrait(TRAIT_ENEMY);}
     bool isDead() const {return m_dead;}
-    virtual void setDead() {m_dead = true;}
+    virtual void setDead();
     virtual void doSomething() { if (isDead()) return;}
-    virtual int dropGoodie() {return -1;}
+    
+    // Called by the world's pickup pass when this actor shares the
+    // player's cell once the player has moved. Enemies do not use it: they
+    // check for the player in their own turns, before and after they move.
+    virtual void contactPlayer() {}
+    void saveState(ActorState& state) const;
+    void loadState(const ActorState& state);
+    
+    // An actor thinks unless it is dormant, waiting or frozen. One that
+    // starts thinking again goes back on its group's awake list, as does one
+    // that has died, so it gets swept.
+    bool isAwake() const {return !m_dormant && !m_waiting && m_thinkInterval != 0;}
+    
+    // How often the actor thinks, set by the world's ChunkGrid from how far
+    // its chunk is from the player: every tick (1), on the ticks where
+    // (tick + phase) is a multiple of the interval, or not at all (0)
+    int thinkInterval() const {return m_thinkInterval;}
+    bool thinksOn(long long tick) const {return m_thinkInterval == 1 || (tick + m_thinkPhase) % m_thinkInterval == 0;}
+    void setThinkInterval(int interval, int phase)
+    {
+        m_thinkInterval = interval;
+        m_thinkPhase = phase;
+        relist();
+    }
+    
+    // Actors with TRAIT_DORMANT are dormant for life; the pickup pass
+    // does everything they take part in
+    bool isDormant() const {return m_dormant;}
+    void setDormant(bool dormant)
+    {
+        m_dormant = dormant;
+        relist();
+    }
+    
+    // Waiting actors sleep on the world's timer wheel until their wake-up
+    // tick, or until the player steps into their cell
+    bool isWaiting() const {return m_waiting;}
+    void setWaiting(bool waiting)
+    {
+        m_waiting = waiting;
+        relist();
+    }
+    
+    // Used by TimerWheel: the tick the actor's timer is due, or -1, and
+    // where the timer sits in its slot
+    long long timerTick() const {return m_timerTick;}
+    void setTimerTick(long long tick) {m_timerTick = tick;}
+    std::size_t timerIndex() const {return m_timerIndex;}
+    void setTimerIndex(std::size_t index) {m_timerIndex = index;}
+    
+    // Set by the world when the actor is placed: its position among every
+    // actor the world has created, whatever its type
+    unsigned int serial() const {return m_serial;}
+    void setSerial(unsigned int serial) {m_serial = serial;}
+    
+    // Used by ActorGroup to keep its awake list in spawn order
+    unsigned int spawnOrder() const {return m_spawnOrder;}
+    void setAwakeList(std::vector<Actor*>* list, unsigned int spawnOrder)
+    {
+        m_awakeList = list;
+        m_spawnOrder = spawnOrder;
+        m_onAwakeList = false;
+        relist();
+    }
+    void leftAwakeList() {m_onAwakeList = false;}
+    
+    // Used by ActorGroup: where the actor sits in its group's full list
+    std::size_t groupIndex() const {return m_groupIndex;}
+    void setGroupIndex(std::size_t index) {m_groupIndex = index;}
+    
+protected:
+    virtual void moved(int fromX, int fromY);
     
 private:
     StudentWorld* m_world;
+    unsigned char m_traits;
     bool m_dead;
-};
-
-// Floor
-class Floor : public Actor
-{
-public:
-    Floor(int startX,
-          int startY,
-          StudentWorld* world);
-    ~Floor() {}
+    bool m_dormant;
+    bool m_waiting;
+    bool m_onAwakeList;
+    int m_thinkInterval;
+    int m_thinkPhase;
+    unsigned int m_spawnOrder;
+    unsigned int m_serial;
+    long long m_timerTick;
+    std::size_t m_timerIndex;
+    std::size_t m_groupIndex;
+    std::vector<Actor*>* m_awakeList;
     
-    virtual bool isObstacle() const {return true;}
-};
-
-// Ladder
-class Ladder : public Actor
-{
-public:
-    Ladder(int startX,
-          int startY,
-          StudentWorld* world);
-    ~Ladder() {}
-    virtual bool canClimb() const {return true;}
+    void relist()
+    {
+        if ((isAwake() || m_dead) && !m_onAwakeList && m_awakeList != nullptr)
+        {
+            m_awakeList->push_back(this);
+            m_onAwakeList = true;
+        }
+    }
 };
 
 // Player
-class Player : public Actor
+class Player final : public Actor
 {
 public:
     Player(int startX,
@@ -67,6 +181,8 @@ public:
     void frozen() {m_freezeTimer += 50;}
     virtual void setDead();
     virtual void doSomething();
+    void saveState(ActorState& state) const;
+    void loadState(const ActorState& state);
 private:
     int m_burps;
     int m_freezeTimer;
@@ -74,7 +190,7 @@ private:
 };
 
 // Bonfire
-class Bonfire : public Actor
+class Bonfire final : public Actor
 {
 public:
     Bonfire(int startX,
@@ -95,14 +211,14 @@ public:
            StudentWorld* world,
            int score);
     ~Goodie() {}
-    virtual void doSomething();
+    virtual void contactPlayer();
     virtual void buff() const = 0;
 private:
     int m_scoreWorth;
     void incScore();
 };
 
-class ExtraLifeGoodie : public Goodie
+class ExtraLifeGoodie final : public Goodie
 {
 public:
     ExtraLifeGoodie(int startX,
@@ -112,7 +228,7 @@ public:
     virtual void buff() const;
 };
 
-class GarlicGoodie : public Goodie
+class GarlicGoodie final : public Goodie
 {
 public:
     GarlicGoodie(int startX,
@@ -135,17 +251,22 @@ public:
     
     virtual bool Attack();
     virtual void EnemyOnly() {}
-    virtual bool isEnemy() const {return true;}
     virtual void specialMove() = 0;
     virtual void doSomething();
     void reverseOrGo(int x, int y);
     int reverseHelper(int direction);
     virtual void setDead();
+    void saveState(ActorState& state) const;
+    void loadState(const ActorState& state);
+protected:
+    // The tick the enemy next needs to think on; until then it waits on the
+    // world's timer wheel
+    virtual long long nextThinkTick() const {return m_nextMove;}
 private:
-    int m_countDown;
+    long long m_nextMove;   // tick of the next specialMove()
 };
 
-class Fireball : public Enemy
+class Fireball final : public Enemy
 {
 public:
     Fireball(int startX,
@@ -154,12 +275,13 @@ public:
     ~Fireball() {}
     
     virtual void specialMove();
-    virtual int dropGoodie() {return 2;}
+    void saveState(ActorState& state) const;
+    void loadState(const ActorState& state);
 private:
     int m_climbState;
 };
 
-class Koopa : public Enemy
+class Koopa final : public Enemy
 {
 public:
     Koopa(int startX,
@@ -170,12 +292,16 @@ public:
     virtual bool Attack();
     virtual void specialMove();
     virtual void EnemyOnly();
-    virtual int dropGoodie() {return 1;}
+    void saveState(ActorState& state) const;
+    void loadState(const ActorState& state);
+protected:
+    virtual long long nextThinkTick() const;
 private:
-    int m_freezeCD;
+    long long m_freezeEnd;      // tick whose cooldown step ends the freeze cooldown
+    long long m_cooledThrough;  // last tick whose cooldown step has been taken
 };
 
-class Barrel : public Enemy
+class Barrel final : public Enemy
 {
 public:
     Barrel (int startX,
@@ -184,21 +310,26 @@ public:
             int direction);
     ~Barrel() {}
     
-    virtual bool fireProof() const {return false;}
     virtual void EnemyOnly();
     virtual void specialMove();
+    void saveState(ActorState& state) const;
+    void loadState(const ActorState& state);
+protected:
+    virtual long long nextThinkTick() const;
 private:
     bool m_fallen;
 };
 
 // Kong
-class Kong : public Actor
+class Kong final : public Actor
 {
 public:
     Kong(int startX, int startY, StudentWorld* world, int direction);
     ~Kong() {}
     
     virtual void doSomething();
+    void saveState(ActorState& state) const;
+    void loadState(const ActorState& state);
 
 private:
     bool m_flee;
@@ -210,7 +341,7 @@ private:
 };
 
 // Burp
-class Burp : public Actor
+class Burp final : public Actor
 {
 public:
     Burp(int startX,
@@ -220,6 +351,8 @@ public:
     ~Burp() {}
     
     virtual void doSomething();
+    void saveState(ActorState& state) const;
+    void loadState(const ActorState& state);
 private:
     int m_life;
 };
@@ -0,0 +1,299 @@
+#ifndef ACTORPOOL_H_
+#define ACTORPOOL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <utility>
+#include <vector>
+
+// ActorPool
+// Free-list storage for one Actor subclass. Slots are carved out of fixed
+// size blocks and recycled through an intrusive free list, so after a level
+// has warmed up, creating and destroying actors touches no general-purpose
+// heap. releaseAll() returns every block at once and must only be called
+// after each actor created from the pool has been released.
+template <typename T, int BlockSize = 32>
+class ActorPool
+{
+public:
+    ActorPool() : m_free(nullptr) {}
+    ~ActorPool() {releaseAll();}
+    
+    template <typename... Args>
+    T* create(Args&&... args)
+    {
+        if (m_free == nullptr) grow();
+        Slot* slot = m_free;
+        m_free = slot->next;
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+    
+    void release(T* p)
+    {
+        p->~T();
+        Slot* slot = reinterpret_cast<Slot*>(p);
+        slot->next = m_free;
+        m_free = slot;
+    }
+    
+    void releaseAll()
+    {
+        for (Slot* block : m_blocks)
+            delete [] block;
+        m_blocks.clear();
+        m_free = nullptr;
+    }
+    
+private:
+    union Slot
+    {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+    
+    // Prevent copying or assigning ActorPools
+    ActorPool(const ActorPool&);
+    ActorPool& operator=(const ActorPool&);
+    
+    void grow()
+    {
+        Slot* block = new Slot[BlockSize];
+        m_blocks.push_back(block);
+        for (int i = BlockSize - 1; i >= 0; i--)
+        {
+            block[i].next = m_free;
+            m_free = &block[i];
+        }
+    }
+    
+    std::vector<Slot*> m_blocks;
+    Slot* m_free;
+};
+
+// What ActorGroup::nextTurn() returns once every due actor has had its turn
+const unsigned int NO_TURN = ~0u;
+
+// ActorGroup
+// Every live actor of one concrete type: the pool that stores them and a
+// dense list in creation order, plus the subset that is awake. Turns still
+// go in creation order across all groups, as they did when every actor was
+// on one list, since who moves first decides who meets whom: the world
+// hands the turn to the group holding the oldest due actor, and that group
+// runs its actors through a statically typed pointer until another group's
+// next one is older. Actors created together, such as the barrels a Kong
+// throws, make long runs of one kind; sleeping actors are skipped without
+// being visited. Awake actors that only think every few ticks (see
+// ChunkGrid) stay listed but are passed over on the ticks they are not due.
+template <typename T>
+class ActorGroup
+{
+public:
+    typedef T ActorType;
+    
+    ActorGroup() : m_unsorted(false), m_ordered(0), m_due(0), m_next(0), m_kept(0), m_tick(0), m_nextSpawnOrder(0) {}
+    ~ActorGroup() {clear();}
+    
+    template <typename... Args>
+    T* spawn(Args&&... args)
+    {
+        T* p = m_pool.create(std::forward<Args>(args)...);
+        p->setGroupIndex(m_actors.size());
+        m_actors.push_back(p);
+        p->setAwakeList(&m_awake, m_nextSpawnOrder++);
+        return p;
+    }
+    
+    // Fixes which actors take part in the coming pass. The world calls this
+    // on every group before any turn is taken, so an actor spawned or woken
+    // during the pass, such as a barrel Kong throws, waits until the next
+    // tick just as it did on the single list.
+    void beginTick(long long tick)
+    {
+        m_tick = tick;
+        mergeWoken();
+        m_due = m_awake.size();
+        m_next = 0;
+        m_kept = 0;
+    }
+    
+    // Serial of the next actor due in this pass, or NO_TURN. Entries for
+    // actors put to sleep since they were listed are dropped on the way, and
+    // those not thinking this tick are kept without taking a turn.
+    unsigned int nextTurn()
+    {
+        for (; m_next < m_due; m_next++)
+        {
+            Actor* p = m_awake[m_next];
+            if (!p->isAwake()) p->leftAwakeList();
+            else if (p->thinksOn(m_tick)) return p->serial();
+            else m_awake[m_kept++] = p;
+        }
+        return NO_TURN;
+    }
+    
+    // Runs due actors in spawn order, which is also serial order, until the
+    // next one's serial reaches limit
+    void tickUntil(unsigned int limit)
+    {
+        while (m_next < m_due)
+        {
+            Actor* p = m_awake[m_next];
+            if (!p->isAwake())
+            {
+                p->leftAwakeList();
+                m_next++;
+                continue;
+            }
+            if (!p->thinksOn(m_tick))
+            {
+                m_awake[m_kept++] = p;
+                m_next++;
+                continue;
+            }
+            if (p->serial() >= limit) return;
+            m_awake[m_kept++] = p;
+            m_next++;
+            static_cast<T*>(p)->doSomething();
+        }
+    }
+    
+    // Closes the pass: the actors listed during it go after the ones that
+    // were due, ready for the next beginTick() to merge them in
+    void endTick()
+    {
+        std::size_t kept = m_kept;
+        for (std::size_t i = m_next; i < m_due; i++)
+            m_awake[kept++] = m_awake[i];
+        m_ordered = kept;
+        for (std::size_t i = m_due; i < m_awake.size(); i++)
+            m_awake[kept++] = m_awake[i];
+        m_awake.resize(kept);
+        m_due = m_next = m_kept = 0;
+    }
+    
+    // Releases dead actors, calling onDead(p) for each first; survivors keep
+    // their order. Sleeping or frozen actors can die too, when a bonfire or
+    // burp in their cell burns or hits them, but Actor::setDead() clears their
+    // sleep and puts them back on the awake list, so a dead actor is always
+    // found there. Each is swapped out of the full list by the index it
+    // carries, so the cost follows the awake list and the deaths, not the
+    // size of the group; actors() puts the full list back in spawn order
+    // when it is next asked for.
+    template <typename F>
+    void sweep(F onDead)
+    {
+        std::size_t kept = 0, ordered = 0;
+        for (std::size_t i = 0; i < m_awake.size(); i++)
+        {
+            Actor* p = m_awake[i];
+            if (p->isDead())
+            {
+                onDead(static_cast<T*>(p));
+                removeActor(static_cast<T*>(p));
+                continue;
+            }
+            m_awake[kept++] = p;
+            if (i < m_ordered) ordered++;
+        }
+        m_awake.resize(kept);
+        m_ordered = ordered;
+    }
+    
+    // Rebuilds the awake list from every actor's state, in spawn
+    // order, after the actors have been rewritten wholesale
+    void resetAwake()
+    {
+        actors();
+        m_awake.clear();
+        m_nextSpawnOrder = 0;
+        for (T* p : m_actors)
+            p->setAwakeList(&m_awake, m_nextSpawnOrder++);
+        m_ordered = m_awake.size();
+    }
+    
+    // Releases actors from the back until only the first n remain
+    void truncate(std::size_t n)
+    {
+        actors();
+        if (m_actors.size() <= n) return;
+        while (m_actors.size() > n)
+        {
+            m_pool.release(m_actors.back());
+            m_actors.pop_back();
+        }
+        resetAwake();
+    }
+    
+    // Releases every actor. The pool keeps its blocks, so the next level
+    // reuses them instead of growing the pool again.
+    void clear()
+    {
+        for (T* p : m_actors)
+            m_pool.release(p);
+        m_actors.clear();
+        m_unsorted = false;
+        m_awake.clear();
+        m_ordered = 0;
+        m_due = m_next = m_kept = 0;
+        m_nextSpawnOrder = 0;
+    }
+    
+    // Every live actor, in spawn order
+    const std::vector<T*>& actors() const
+    {
+        if (m_unsorted)
+        {
+            std::sort(m_actors.begin(), m_actors.end(), bySpawnOrder);
+            for (std::size_t i = 0; i < m_actors.size(); i++)
+                m_actors[i]->setGroupIndex(i);
+            m_unsorted = false;
+        }
+        return m_actors;
+    }
+    
+private:
+    // Prevent copying or assigning ActorGroups
+    ActorGroup(const ActorGroup&);
+    ActorGroup& operator=(const ActorGroup&);
+    
+    static bool bySpawnOrder(const Actor* a, const Actor* b) {return a->spawnOrder() < b->spawnOrder();}
+    
+    void removeActor(T* p)
+    {
+        std::size_t i = p->groupIndex();
+        T* last = m_actors.back();
+        m_actors[i] = last;
+        last->setGroupIndex(i);
+        m_actors.pop_back();
+        if (i != m_actors.size()) m_unsorted = true;
+        m_pool.release(p);
+    }
+    
+    // Puts actors appended since the last pass back among the others
+    void mergeWoken()
+    {
+        if (m_ordered == m_awake.size()) return;
+        std::sort(m_awake.begin() + m_ordered, m_awake.end(), bySpawnOrder);
+        m_merged.clear();
+        std::merge(m_awake.begin(), m_awake.begin() + m_ordered, m_awake.begin() + m_ordered, m_awake.end(),
+                   std::back_inserter(m_merged), bySpawnOrder);
+        m_awake.swap(m_merged);
+        m_ordered = m_awake.size();
+    }
+    
+    ActorPool<T> m_pool;
+    mutable std::vector<T*> m_actors; // every live actor, in spawn order unless m_unsorted
+    mutable bool m_unsorted;          // an actor was swapped out of the middle of m_actors
+    std::vector<Actor*> m_awake;  // those that are awake, plus any since put to sleep or killed
+    std::vector<Actor*> m_merged; // scratch for mergeWoken()
+    std::size_t m_ordered;        // leading entries of m_awake known to be in spawn order
+    std::size_t m_due;            // leading entries of m_awake taking part in this pass
+    std::size_t m_next;           // the next of those to visit
+    std::size_t m_kept;           // those visited and still listed, moved to the front
+    long long m_tick;             // the tick this pass belongs to
+    unsigned int m_nextSpawnOrder;
+};
+
+#endif // ACTORPOOL_H_
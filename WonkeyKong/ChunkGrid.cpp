@@ -0,0 +1,135 @@
+#include "ChunkGrid.h"
+#include <algorithm>
+#include <cstdlib>
+using namespace std;
+
+ChunkGrid::ChunkGrid()
+: m_config(defaultConfig()), m_width(0), m_height(0), m_chunksX(0), m_chunksY(0),
+  m_focusX(-1), m_focusY(-1)
+{}
+
+void ChunkGrid::reset(int width, int height, const Config& config)
+{
+    m_config = config;
+    if (m_config.chunkSize < 1) m_config.chunkSize = 1;
+    if (m_config.lodRadius < m_config.activeRadius) m_config.lodRadius = m_config.activeRadius;
+    if (m_config.lodInterval < 1) m_config.lodInterval = 1;
+    
+    m_width = width;
+    m_height = height;
+    m_chunksX = (width + m_config.chunkSize - 1) / m_config.chunkSize;
+    m_chunksY = (height + m_config.chunkSize - 1) / m_config.chunkSize;
+    clear();
+    m_chunks.resize(static_cast<size_t>(m_chunksX) * m_chunksY);
+}
+
+void ChunkGrid::clear()
+{
+    for (Chunk& chunk : m_chunks)
+    {
+        chunk.actors.clear();
+        chunk.interval = 1;
+    }
+    m_focusX = m_focusY = -1;
+}
+
+void ChunkGrid::add(Actor* ap)
+{
+    int chunk = chunkAt(ap->getX(), ap->getY());
+    if (chunk < 0) return;
+    m_chunks[chunk].actors.push_back(ap);
+    apply(ap, chunk);
+}
+
+void ChunkGrid::remove(Actor* ap, int x, int y)
+{
+    int chunk = chunkAt(x, y);
+    if (chunk < 0) return;
+    vector<Actor*>& actors = m_chunks[chunk].actors;
+    vector<Actor*>::iterator it = find(actors.begin(), actors.end(), ap);
+    if (it == actors.end()) return;
+    *it = actors.back();
+    actors.pop_back();
+}
+
+void ChunkGrid::move(Actor* ap, int fromX, int fromY)
+{
+    int from = chunkAt(fromX, fromY);
+    int to = chunkAt(ap->getX(), ap->getY());
+    if (from == to) return;
+    remove(ap, fromX, fromY);
+    if (to >= 0) add(ap);
+    else ap->setThinkInterval(1, 0);
+}
+
+void ChunkGrid::focus(int x, int y)
+{
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height) return;
+    int cx = x / m_config.chunkSize;
+    int cy = y / m_config.chunkSize;
+    if (cx == m_focusX && cy == m_focusY) return;
+    
+    int oldX = m_focusX, oldY = m_focusY;
+    m_focusX = cx;
+    m_focusY = cy;
+    
+    // The first focus sets every chunk; after that, only chunks within range
+    // of the old or the new position can change
+    int r = m_config.lodRadius + 1;
+    if (oldX < 0)
+        refresh(0, 0, m_chunksX - 1, m_chunksY - 1, false);
+    else
+        refresh(min(oldX, cx) - r, min(oldY, cy) - r, max(oldX, cx) + r, max(oldY, cy) + r, false);
+}
+
+void ChunkGrid::refocus(int x, int y)
+{
+    if (x >= 0 && x < m_width && y >= 0 && y < m_height)
+    {
+        m_focusX = x / m_config.chunkSize;
+        m_focusY = y / m_config.chunkSize;
+    }
+    refresh(0, 0, m_chunksX - 1, m_chunksY - 1, true);
+}
+
+int ChunkGrid::chunkAt(int x, int y) const
+{
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height) return -1;
+    return (y / m_config.chunkSize) * m_chunksX + x / m_config.chunkSize;
+}
+
+int ChunkGrid::intervalAt(int cx, int cy) const
+{
+    if (m_focusX < 0) return 1;
+    int distance = max(abs(cx - m_focusX), abs(cy - m_focusY));
+    if (distance <= m_config.activeRadius) return 1;
+    if (distance <= m_config.lodRadius) return m_config.lodInterval;
+    return 0;
+}
+
+void ChunkGrid::refresh(int cx0, int cy0, int cx1, int cy1, bool force)
+{
+    cx0 = max(cx0, 0);
+    cy0 = max(cy0, 0);
+    cx1 = min(cx1, m_chunksX - 1);
+    cy1 = min(cy1, m_chunksY - 1);
+    for (int cy = cy0; cy <= cy1; cy++)
+    {
+        for (int cx = cx0; cx <= cx1; cx++)
+        {
+            int chunk = cy * m_chunksX + cx;
+            int interval = intervalAt(cx, cy);
+            if (interval == m_chunks[chunk].interval && !force) continue;
+            m_chunks[chunk].interval = interval;
+            for (Actor* ap : m_chunks[chunk].actors)
+                apply(ap, chunk);
+        }
+    }
+}
+
+void ChunkGrid::apply(Actor* ap, int chunk) const
+{
+    // A dead actor keeps thinking every tick so its group sweeps it
+    if (ap->isDead()) return;
+    ap->setThinkInterval(m_chunks[chunk].interval, chunk);
+}
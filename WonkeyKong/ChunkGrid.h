@@ -0,0 +1,92 @@
+#ifndef CHUNKGRID_H_
+#define CHUNKGRID_H_
+
+#include "Actor.h"
+#include <vector>
+
+// ChunkGrid
+// Splits the board into square chunks, each holding the actors standing in
+// it, so the world's cell queries look at one chunk's list instead of a
+// per-cell index the size of the board. It also sets how often the actors
+// in each chunk think, by distance in chunks (the larger of dx and dy) from
+// the chunk the player is in:
+//   up to activeRadius     every tick
+//   up to lodRadius        every lodInterval ticks, staggered by chunk
+//   further away           not at all, until the player comes closer
+// When the player changes chunk only the chunks around the old and new
+// positions are revisited, so the cost follows the player rather than the
+// size of the board. Actors off the board belong to no chunk and keep
+// thinking every tick.
+class ChunkGrid
+{
+public:
+    struct Config
+    {
+        int chunkSize;      // cells per side
+        int activeRadius;
+        int lodRadius;
+        int lodInterval;
+    };
+    
+    // Large enough that a standard 20x20 board is always fully active, and
+    // that everything in a VIEW_WIDTH x VIEW_HEIGHT window around the player
+    // thinks every tick
+    static Config defaultConfig() {return Config{8, 2, 4, 4};}
+    
+    ChunkGrid();
+    
+    // Empties every chunk and lays out a width x height board; the next
+    // focus() call decides every chunk's rate
+    void reset(int width, int height, const Config& config);
+    void clear();
+    
+    void add(Actor* ap);
+    void remove(Actor* ap, int x, int y);
+    void move(Actor* ap, int fromX, int fromY);
+    
+    // Where the player is now
+    void focus(int x, int y);
+    
+    // As focus(), but sets every chunk's rate and every actor's again, for
+    // after the chunks have been refilled wholesale
+    void refocus(int x, int y);
+    
+    // Calls f(ap) for every actor standing in cell (x, y), in no particular order
+    template <typename F>
+    void forEachAt(int x, int y, F f) const
+    {
+        int chunk = chunkAt(x, y);
+        if (chunk < 0) return;
+        for (Actor* ap : m_chunks[chunk].actors)
+            if (ap->getX() == x && ap->getY() == y) f(ap);
+    }
+    
+    // The chunk holding cell (x, y), or -1 off the board
+    int chunkAt(int x, int y) const;
+    int numChunks() const {return static_cast<int>(m_chunks.size());}
+    const std::vector<Actor*>& actorsIn(int chunk) const {return m_chunks[chunk].actors;}
+    
+    const Config& config() const {return m_config;}
+    
+private:
+    struct Chunk
+    {
+        std::vector<Actor*> actors;
+        int interval;               // as for Actor::setThinkInterval()
+    };
+    
+    int intervalAt(int cx, int cy) const;
+    void refresh(int cx0, int cy0, int cx1, int cy1, bool force);
+    void apply(Actor* ap, int chunk) const;
+    
+    Config m_config;
+    int m_width;
+    int m_height;
+    int m_chunksX;
+    int m_chunksY;
+    std::vector<Chunk> m_chunks;
+    int m_focusX;                   // the player's chunk, or -1 before the first focus()
+    int m_focusY;
+};
+
+#endif // CHUNKGRID_H_
@@ -1,9 +1,6 @@
 #ifndef GAMECONSTANTS_H_
 #define GAMECONSTANTS_H_
 
-#include <random>
-#include <utility>
-
 // image IDs for the game objects
 
 const int IID_PLAYER = 0;
@@ -64,17 +61,4 @@ const int MAX_LEVELS = 99;
 const double SPRITE_WIDTH_GL = .48; // note - this is tied implicitly to SPRITE_WIDTH due to carey's sloppy openGL programming
 const double SPRITE_HEIGHT_GL = .4; // note - this is tied implicitly to SPRITE_HEIGHT due to carey's sloppy openGL programming
 
-// Return a uniformly distributed random int from min to max, inclusive
-
-inline
-int randInt(int min, int max)
-{
-	if (max < min)
-		std::swap(max, min);
-	static std::random_device rd;
-	static std::default_random_engine generator(rd());
-	std::uniform_int_distribution<> distro(min, max);
-	return distro(generator);
-}
-
 #endif // GAMECONSTANTS_H_
@@ -0,0 +1,486 @@
+#include "freeglut.h"
+#include "GameController.h"
+#include "GameWorld.h"
+#include "GameConstants.h"
+#include "GraphObject.h"
+#include "TileLayer.h"
+#include "SoundFX.h"
+#include "SpriteManager.h"
+#include <string>
+#include <map>
+#include <set>
+#include <utility>
+#include <cstdlib>
+#include <algorithm>
+using namespace std;
+
+/*
+spriteWidth = .67
+spritesPerRow = 16
+
+RowWidth = spriteWidth*spritesPerRow = 10.72
+PixelWidth = RowWidth/256 = .041875
+newSpriteWidth = PixelWidth * NumPixels
+
+spriteHeight = .54
+spritesPerRow = 12
+
+RowHeight = spriteHeight*spritesPerRow = 6.48
+
+PixelHeight = RowHeight/256 = .0253125
+
+newSpriteHeight = PixelHeight * NumPixels
+*/
+
+static const int WINDOW_WIDTH = 768;
+static const int WINDOW_HEIGHT = 768;
+
+static const int PERSPECTIVE_NEAR_PLANE = 4;
+static const int PERSPECTIVE_FAR_PLANE	= 22;
+
+static const double VISIBLE_MIN_X = -2.39;
+static const double VISIBLE_MAX_X = 2.39;
+static const double VISIBLE_MIN_Y = -2.1;
+static const double VISIBLE_MAX_Y = 1.9;
+static const double VISIBLE_MIN_Z = -20;
+
+static const double FONT_SCALEDOWN = 760.0;
+
+static const double SCORE_Y = 3.8;
+static const double SCORE_Z = -10;
+
+static const int DEEPEST_DEPTH = 3;
+
+int GameController::m_msPerTick = 10;
+
+struct SpriteInfo
+{
+	int imageID;
+	int frameNum;
+	int depth;		// deeper images are drawn first, underneath
+	std::string tgaFileName;
+};
+
+static void convertToGlutCoords(double x, double y, double& gx, double& gy, double& gz);
+static void drawPrompt(string mainMessage, string secondMessage);
+static void drawScoreAndLives(string);
+
+enum GameController::GameControllerState : int {
+	welcome, contgame, finishedlevel, init, cleanup, makemove, animate, gameover, prompt, quit, not_applicable
+};
+
+void GameController::initDrawersAndSounds()
+{
+	SpriteInfo drawers[] = {
+		{ IID_PLAYER, 0, 0, "player.tga" },
+		{ IID_KONG, 0, 1, "kong.tga" },
+		{ IID_BARREL, 0, 1, "barrel.tga" },
+		{ IID_FIREBALL, 0, 1, "fireball.tga" },
+		{ IID_KOOPA, 0, 1, "koopa.tga" },
+		{ IID_BURP, 0, 1, "burp.tga" },
+		{ IID_EXTRA_LIFE_GOODIE, 0, 2, "extra_life.tga" },
+		{ IID_GARLIC_GOODIE, 0, 2, "garlic.tga" },
+		{ IID_BONFIRE, 0, 2, "bonfire.tga" },
+		{ IID_FLOOR, 0, DEEPEST_DEPTH, "floor.tga" },
+		{ IID_LADDER, 0, DEEPEST_DEPTH, "ladder.tga" },
+	};
+
+	SoundMapType::value_type sounds[] = {
+		make_pair(SOUND_THEME, "theme.wav"),
+		make_pair(SOUND_ENEMY_DIE, "enemy_die.wav"),
+		make_pair(SOUND_PLAYER_DIE, "player_die.wav"),
+		make_pair(SOUND_BURP, "burp.wav"),
+		make_pair(SOUND_GOT_GOODIE, "got_goodie.wav"),
+		make_pair(SOUND_FINISHED_LEVEL, "finished_level.wav"),
+		make_pair(SOUND_JUMP, "jump.wav"),
+	};
+
+	for (const SpriteInfo& drawer : drawers)
+	{
+		string path = m_gw->assetPath() + drawer.tgaFileName;
+		if (!m_spriteManager.loadSprite(path, drawer.imageID, drawer.frameNum))
+			exit(0);
+		m_imageNameMap[drawer.imageID] = drawer.tgaFileName;
+	}
+	  // Only once every frame is loaded, since the render list resolves them all
+	for (const SpriteInfo& drawer : drawers)
+		m_renderList.setImage(m_spriteManager, drawer.imageID, drawer.depth);
+	for (const SoundMapType::value_type& sound : sounds)
+		m_soundMap[sound.first] = sound.second;
+}
+
+static void doSomethingCallback()
+{
+	Game().doSomething();
+}
+
+static void reshapeCallback(int w, int h)
+{
+	Game().reshape(w, h);
+}
+
+static void keyboardEventCallback(unsigned char key, int x, int y)
+{
+	Game().keyboardEvent(key, x, y);
+}
+
+static void specialKeyboardEventCallback(int key, int x, int y)
+{
+	Game().specialKeyboardEvent(key, x, y);
+}
+
+void GameController::timerFuncCallback(int)
+{
+	Game().doSomething();
+	glutTimerFunc(m_msPerTick, timerFuncCallback, 0);
+}
+
+void GameController::run(int argc, char* argv[], GameWorld* gw, string windowTitle, int msPerTick)
+{
+	gw->setController(this);
+	m_gw = gw;
+	m_gameState = welcome;
+	m_singleStep = false;
+	m_postInitPreCleanup = false;
+	m_curIntraFrameTick = 0;
+	m_playerWon = false;
+	m_msPerTick = msPerTick;
+
+	glutInit(&argc, argv);
+	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
+	glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
+	glutInitWindowPosition(0, 0);
+	glutCreateWindow(windowTitle.c_str());
+
+	initDrawersAndSounds();
+
+	glutKeyboardFunc(keyboardEventCallback);
+	glutSpecialFunc(specialKeyboardEventCallback);
+	glutReshapeFunc(reshapeCallback);
+	glutDisplayFunc(doSomethingCallback);
+	glutTimerFunc(m_msPerTick, timerFuncCallback, 0);
+
+	glutMainLoop();
+	delete m_gw;
+}
+
+bool GameController::passesThruWhenSingleStepping(int key) const
+{
+	return key != 'f'  &&  key != 'r';
+}
+
+void GameController::setGameState(GameControllerState s)
+{
+	if (m_gameState != quit)
+		m_gameState = s;
+}
+
+void GameController::quitGame()
+{
+	setGameState(quit);
+}
+
+void GameController::doSomething()
+{
+	switch (m_gameState)
+	{
+		case not_applicable:
+			break;
+		case welcome:
+			playSound(SOUND_THEME);
+			m_mainMessage = "Welcome to Wonky Kong!";
+			m_secondMessage = "Press Enter to begin play...";
+			setGameState(prompt);
+			m_nextStateAfterPrompt = init;
+			break;
+		case contgame:
+			m_mainMessage = "You lost a life!";
+			m_secondMessage = "Press Enter to continue playing...";
+			setGameState(prompt);
+			m_nextStateAfterPrompt = cleanup;
+			break;
+		case finishedlevel:
+			m_mainMessage = "Woot! You finished the level!";
+			m_secondMessage = "Press Enter to continue playing...";
+			setGameState(prompt);
+			m_nextStateAfterPrompt = cleanup;
+			break;
+		case makemove:
+			m_curIntraFrameTick = ANIMATION_POSITIONS_PER_TICK;
+			m_nextStateAfterAnimate = not_applicable;
+			{
+				int status = m_gw->move();
+				if (status == GWSTATUS_PLAYER_DIED)
+				{
+					  // animate one last frame so the player can see what happened
+					m_nextStateAfterAnimate = (m_gw->isGameOver() ? gameover : contgame);
+				}
+				else if (status == GWSTATUS_FINISHED_LEVEL)
+				{
+					m_gw->advanceToNextLevel();
+					  // animate one last frame so the player can see what happened
+					m_nextStateAfterAnimate = finishedlevel;
+				}
+			}
+			setGameState(animate);
+			break;
+		case animate:
+			displayGamePlay();
+			if (m_curIntraFrameTick-- <= 0)
+			{
+				if (m_nextStateAfterAnimate != not_applicable)
+					setGameState(m_nextStateAfterAnimate);
+				else if (!m_singleStep)
+					setGameState(makemove);
+				else
+				{
+					int key;
+					if (getKeyIfAny(key))
+					{
+						if (passesThruWhenSingleStepping(key))
+							putBackKey(key);
+						setGameState(makemove);
+					}
+				}
+			}
+			break;
+		case cleanup:
+			m_gw->cleanUp();
+			m_postInitPreCleanup = false;
+			reportLeakedGraphObjects();
+			setGameState(init);
+			break;
+		case gameover:
+			{
+				ostringstream oss;
+				oss << "Final score: " << m_gw->getScore() << "!";
+				m_mainMessage = oss.str();
+			}
+			m_secondMessage = "Game Over! Thank you for playing!";
+			setGameState(prompt);
+			m_nextStateAfterPrompt = quit;
+			break;
+		case prompt:
+			drawPrompt(m_mainMessage, m_secondMessage);
+			{
+				int key;
+				if (getKeyIfAny(key) && key == '\r')
+					setGameState(m_nextStateAfterPrompt);
+			}
+			break;
+		case init:
+			{
+				int status = m_gw->init();
+				m_postInitPreCleanup = true;
+				SoundFX().abortClip();
+				if (status == GWSTATUS_PLAYER_WON)
+				{
+					m_playerWon = true;
+					m_mainMessage = "Woot! You won the game!";
+					m_secondMessage = "Final score: " + to_string(m_gw->getScore()) + "!";
+					setGameState(prompt);
+					m_nextStateAfterPrompt = quit;
+				}
+				else if (status == GWSTATUS_LEVEL_ERROR)
+				{
+					m_mainMessage = "Error in level data file encoding!";
+					m_secondMessage = "Every level needs one player and one Kong on a 20x20 board";
+					setGameState(prompt);
+					m_nextStateAfterPrompt = quit;
+				}
+				else if (status == GWSTATUS_NOT_IMPLEMENTED)
+				{
+					m_mainMessage = "This level has not been implemented yet!";
+					m_secondMessage = "";
+					setGameState(prompt);
+					m_nextStateAfterPrompt = quit;
+				}
+				else
+					setGameState(makemove);
+			}
+			break;
+		case quit:
+			if (m_postInitPreCleanup)
+			{
+				m_gw->cleanUp();
+				m_postInitPreCleanup = false;
+			}
+			reportLeakedGraphObjects();
+			reportInputMetrics();
+			glutLeaveMainLoop();
+			break;
+	}
+}
+
+void GameController::keyboardEvent(unsigned char key, int /* x */, int /* y */)
+{
+	switch (key)
+	{
+		case 'a': case '4': postKey(KEY_PRESS_LEFT);	break;
+		case 'd': case '6': postKey(KEY_PRESS_RIGHT);	break;
+		case 'w': case '8': postKey(KEY_PRESS_UP);		break;
+		case 's': case '2': postKey(KEY_PRESS_DOWN);	break;
+		case 'f':			m_singleStep = true;		break;
+		case 'r':			m_singleStep = false;		break;
+		case 'q': case 'Q': setGameState(quit);			break;
+		default:			postKey(key);				break;
+	}
+}
+
+void GameController::specialKeyboardEvent(int key, int /* x */, int /* y */)
+{
+	switch (key)
+	{
+		case GLUT_KEY_LEFT:	 postKey(KEY_PRESS_LEFT);	break;
+		case GLUT_KEY_RIGHT: postKey(KEY_PRESS_RIGHT);	break;
+		case GLUT_KEY_UP:	 postKey(KEY_PRESS_UP);		break;
+		case GLUT_KEY_DOWN:	 postKey(KEY_PRESS_DOWN);	break;
+		default:										break;
+	}
+}
+
+void GameController::playSound(int soundID)
+{
+	if (soundID == SOUND_NONE)
+		return;
+
+	SoundMapType::const_iterator p = m_soundMap.find(soundID);
+	if (p != m_soundMap.end())
+		SoundFX().playClip(m_gw->assetPath() + p->second);
+}
+
+void GameController::displayGamePlay()
+{
+	glEnable(GL_DEPTH_TEST); // must be done each time before displaying graphics or gets disabled for some reason
+	glLoadIdentity();
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	gluLookAt(0, 0, 0, 0, 0, -1, 0, 1, 0);
+
+	  // The list sorts the terrain and graph objects by depth and flushes them.
+	  // Only objects marked dirty since the last frame are placed again, and
+	  // the second frame of each tick, with nothing moved, redraws the
+	  // retained vertex data as it is. Boards larger than the window are drawn
+	  // from the world's view origin.
+	int viewX, viewY;
+	m_gw->getViewOrigin(viewX, viewY);
+	m_renderList.setView(viewX, viewY, VIEW_WIDTH, VIEW_HEIGHT);
+	m_renderList.build(GraphObject::getGraphObjects(), m_gw->tileLayer(), m_spriteManager,
+					   [viewX, viewY](double x, double y, double& gx, double& gy, double& gz) {
+						   convertToGlutCoords(x - viewX, y - viewY, gx, gy, gz);
+					   });
+	m_renderList.draw(m_spriteManager);
+
+	drawScoreAndLives(m_gameStatText);
+
+	glutSwapBuffers();
+}
+
+void GameController::reportLeakedGraphObjects() const
+{
+	const GraphObject::Registry& graphObjects = GraphObject::getGraphObjects();
+	if (graphObjects.empty())
+		return;
+
+	cout << "***** " << graphObjects.size() << " leaked objects:" << endl;
+	for (const GraphObject* obj : graphObjects)
+		cout << "Object at (" << obj->getX() << "," << obj->getY() << ")" << endl;
+	exit(0);
+}
+
+  // How long keys waited between the keyboard callback and the tick that
+  // read them, and how many never got there
+void GameController::reportInputMetrics() const
+{
+	InputQueue::Metrics m = m_inputQueue.metrics();
+	cout << "Input: " << m.delivered << " keys, mean latency " << m.meanLatencyUs() / 1000
+		 << " ms, max " << m.maxLatencyUs / 1000.0 << " ms; dropped " << m.droppedByPolicy
+		 << " as stale and " << m.droppedFull << " with the queue full" << endl;
+	if (m.delivered == 0)
+		return;
+
+	cout << "Latency (ms):";
+	for (int i = 0; i < InputQueue::NUM_LATENCY_BUCKETS; i++)
+	{
+		if (m.latencyBuckets[i] == 0)
+			continue;
+		if (i == InputQueue::NUM_LATENCY_BUCKETS - 1)
+			cout << " >=" << (1 << (i - 1));
+		else
+			cout << " <" << (1 << i);
+		cout << ":" << m.latencyBuckets[i];
+	}
+	cout << endl;
+}
+
+void GameController::reshape (int w, int h)
+{
+	glViewport (0, 0, (GLsizei)w, (GLsizei)h);
+	glMatrixMode (GL_PROJECTION);
+	glLoadIdentity ();
+	gluPerspective(45.0, double(WINDOW_WIDTH) / WINDOW_HEIGHT, PERSPECTIVE_NEAR_PLANE, PERSPECTIVE_FAR_PLANE);
+	glMatrixMode (GL_MODELVIEW);
+}
+
+static void convertToGlutCoords(double x, double y, double& gx, double& gy, double& gz)
+{
+	x /= VIEW_WIDTH;
+	y /= VIEW_HEIGHT;
+	gx = 2 * VISIBLE_MIN_X + .3 + x * 2 * (VISIBLE_MAX_X - VISIBLE_MIN_X);
+	gy = 2 * VISIBLE_MIN_Y +	  y * 2 * (VISIBLE_MAX_Y - VISIBLE_MIN_Y);
+	gz = .6 * VISIBLE_MIN_Z;
+}
+
+static void doOutputStroke(double x, double y, double z, double size, const char* str, bool centered)
+{
+	if (centered)
+	{
+		double len = glutStrokeLength(GLUT_STROKE_ROMAN, reinterpret_cast<const unsigned char*>(str)) / FONT_SCALEDOWN;
+		x = -len / 2;
+		size = 1;
+	}
+	GLfloat scaledSize = static_cast<GLfloat>(size / FONT_SCALEDOWN);
+	glPushMatrix();
+	glLineWidth(1);
+	glLoadIdentity();
+	glTranslatef(static_cast<GLfloat>(x), static_cast<GLfloat>(y), static_cast<GLfloat>(z));
+	glScalef(scaledSize, scaledSize, scaledSize);
+	for ( ; *str != '\0'; str++)
+		glutStrokeCharacter(GLUT_STROKE_ROMAN, *str);
+	glPopMatrix();
+}
+
+static void outputStrokeCentered(double y, double z, const char* str)
+{
+	doOutputStroke(0, y, z, 1, str, true);
+}
+
+static void drawPrompt(string mainMessage, string secondMessage)
+{
+	glEnable(GL_DEPTH_TEST); // must be done each time before displaying graphics or gets disabled for some reason
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glLoadIdentity ();
+	gluLookAt(0, 0, 0, 0, 0, -1, 0, 1, 0);
+	glColor3f (1.0, 1.0, 1.0);
+	glTranslatef (0.0f, 0.0f, -1.0f);
+	outputStrokeCentered(1, -5, mainMessage.c_str());
+	outputStrokeCentered(-1, -5, secondMessage.c_str());
+	glutSwapBuffers();
+}
+
+static void drawScoreAndLives(string gameStatText)
+{
+	static int RATE = 1;
+	static GLfloat rgb[3] =
+		{ static_cast<GLfloat>(.6), static_cast<GLfloat>(.6), static_cast<GLfloat>(.6) };
+	for (int k = 0; k < 3; k++)
+	{
+		double strength = rgb[k] + (-RATE + rand() % (3*RATE)) / 100.0;
+		if (strength < .6)
+			strength = .6;
+		else if (strength > 1.0)
+			strength = 1.0;
+		rgb[k] = static_cast<GLfloat>(strength);
+	}
+	glColor3f(rgb[0], rgb[1], rgb[2]);
+	outputStrokeCentered(SCORE_Y, SCORE_Z, gameStatText.c_str());
+}
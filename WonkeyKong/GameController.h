@@ -2,6 +2,8 @@
 #define GAMECONTROLLER_H_
 
 #include "SpriteManager.h"
+#include "RenderList.h"
+#include "InputQueue.h"
 #include <string>
 #include <map>
 #include <iostream>
@@ -18,18 +20,30 @@ class GameController
 
 	bool getKeyIfAny(int& value)
 	{
-		if (m_lastKeyHit != INVALID_KEY)
-		{
-			value = m_lastKeyHit;
-			m_lastKeyHit = INVALID_KEY;
-			return true;
-		}
-		return false;
+		return m_inputQueue.pop(value);
 	}
 
 	void putBackKey(int key)
 	{
-		m_lastKeyHit = key;
+		m_inputQueue.putBack(key);
+	}
+
+	  // Called by keyboardEvent() and specialKeyboardEvent() for every key
+	  // meant for the game, instead of overwriting a single last-key slot
+	void postKey(int key)
+	{
+		if (key != INVALID_KEY)
+			m_inputQueue.push(key);
+	}
+
+	void setInputPolicy(InputQueue::Policy policy, int maxBacklog = InputQueue::DEFAULT_BACKLOG)
+	{
+		m_inputQueue.setPolicy(policy, maxBacklog);
+	}
+
+	InputQueue::Metrics inputMetrics() const
+	{
+		return m_inputQueue.metrics();
 	}
 
 	void playSound(int soundID);
@@ -62,7 +76,7 @@ private:
 	GameControllerState	m_gameState;
 	GameControllerState	m_nextStateAfterPrompt;
 	GameControllerState	m_nextStateAfterAnimate;
-	int			m_lastKeyHit;
+	InputQueue	m_inputQueue;
 	bool		m_singleStep;
 	bool		m_postInitPreCleanup;
 	std::string m_gameStatText;
@@ -72,9 +86,11 @@ private:
 	using SoundMapType = std::map<int, std::string>;
 	SoundMapType m_soundMap;
 	std::map<int, std::string> m_imageNameMap;
-	std::map<int, int> m_imageDepthMap;
 	bool		m_playerWon;
 	SpriteManager m_spriteManager;
+	  // Every sprite displayGamePlay() draws; it must be the only thing
+	  // plotting through m_spriteManager
+	RenderList	m_renderList;
 	static int m_msPerTick;
 
     void setGameState(GameControllerState s);
@@ -83,6 +99,7 @@ private:
 	bool passesThruWhenSingleStepping(int key) const;
 	void displayGamePlay();
 	void reportLeakedGraphObjects() const;
+	void reportInputMetrics() const;
 
 };
 
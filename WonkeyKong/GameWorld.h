@@ -7,6 +7,7 @@
 const int START_PLAYER_LIVES = 3;
 
 class GameController;
+class TileLayer;
 
 class GameWorld
 {
@@ -26,6 +27,19 @@ public:
 	virtual int move() = 0;
 	virtual void cleanUp() = 0;
 
+	  // Static terrain to draw underneath the graph objects, if the world has any
+	virtual const TileLayer* tileLayer() const
+	{
+		return nullptr;
+	}
+
+	  // The board cell shown at the bottom left of the VIEW_WIDTH x VIEW_HEIGHT
+	  // window; a world larger than the window moves it to follow the player
+	virtual void getViewOrigin(int& x, int& y) const
+	{
+		x = y = 0;
+	}
+
 	void setGameStatText(std::string text);
 
 	bool getKey(int& value);
@@ -1,7 +1,6 @@
 #ifndef GRAPHOBJ_H_
 #define GRAPHOBJ_H_
 
-#include "SpriteManager.h"
 #include "GameConstants.h"
 
 #include <set>
@@ -19,31 +18,42 @@ class GraphObject
 	static const int up = 90;
 	static const int down = 270;
 
+	typedef std::set<GraphObject*> Registry;
+
 	GraphObject(int imageID, int startX, int startY, int dir = 0, double size = 1.0)
-	 : m_imageID(imageID), m_visible(true), m_x(startX), m_y(startY),
+	 : GraphObject(getGraphObjects(), imageID, startX, startY, dir, size)
+	{
+	}
+
+	  // Registers the object in the given registry rather than the
+	  // process-wide one, so independent worlds can share a process.
+	GraphObject(Registry& registry, int imageID, int startX, int startY, int dir = 0, double size = 1.0)
+	 : m_registry(&registry), m_imageID(imageID), m_visible(true), m_x(startX), m_y(startY),
 	   m_destX(startX), m_destY(startY), m_brightness(1.0),
-	   m_animationNumber(0), m_direction(dir), m_size(size)
+	   m_animationNumber(0), m_direction(dir), m_size(size), m_dirty(true)
 	{
 		if (m_size <= 0)
 			m_size = 1;
 
-		getGraphObjects().insert(this);
+		m_registry->insert(this);
 		setVisible(true);
 	}
 
 	virtual ~GraphObject()
 	{
-		getGraphObjects().erase(this);
+		m_registry->erase(this);
 	}
 
 	void setVisible(bool shouldIDisplay)
 	{
 		m_visible = shouldIDisplay;
+		m_dirty = true;
 	}
 
 	void setBrightness(double brightness)
 	{
 		m_brightness = brightness;
+		m_dirty = true;
 	}
 
 	int getX() const
@@ -60,9 +70,12 @@ class GraphObject
 
 	void moveTo(int x, int y)
 	{
+		int fromX = m_destX;
+		int fromY = m_destY;
 		m_destX = x;
 		m_destY = y;
 		increaseAnimationNumber();
+		moved(fromX, fromY);
 	}
 
 	//virtual void moveAngle(int angle, int units = 1)
@@ -106,11 +119,13 @@ class GraphObject
 			d += 360;
 
 		m_direction = d % 360;
+		m_dirty = true;
 	}
 
 	void setSize(double size)
 	{
 		m_size = size;
+		m_dirty = true;
 	}
 
 	double getSize() const
@@ -155,20 +170,54 @@ class GraphObject
 		//moveALittle(m_y, m_destY);
 	}
 
-	static std::set<GraphObject*>& getGraphObjects()
+	static Registry& getGraphObjects()
 	{
-		static std::set<GraphObject*> graphObjects;
+		static Registry graphObjects;
 		return graphObjects;
 	}
 
 	void increaseAnimationNumber()
 	{
 		m_animationNumber++;
+		m_dirty = true;
+	}
+
+	  // Whether anything drawn has changed since the renderer last looked;
+	  // moveTo() and the other setters above mark it, and RenderList::build()
+	  // clears it once it has placed the object again
+	bool isDirty() const
+	{
+		return m_dirty;
+	}
+
+	void clearDirty()
+	{
+		m_dirty = false;
+	}
+
+
+protected:
+	  // Called by moveTo() once the new location is in place, so derived
+	  // classes can keep any position-keyed bookkeeping current.
+	virtual void moved(int /*fromX*/, int /*fromY*/)
+	{
 	}
 
+	  // Puts the object straight back into a saved state. Unlike moveTo(),
+	  // this neither calls moved() nor advances the animation.
+	void restoreState(int x, int y, int dir, unsigned int animationNumber)
+	{
+		m_x = m_destX = x;
+		m_y = m_destY = y;
+		m_direction = dir;
+		m_animationNumber = animationNumber;
+		m_dirty = true;
+	}
 
 private:
 	friend class GameController;
+	friend class RenderList;
+	friend class SoftwareRenderer;
 	unsigned int getID() const
 	{
 		return m_imageID;
@@ -180,6 +229,7 @@ private:
 	GraphObject& operator=(const GraphObject&);
 
 	static const int NUM_DEPTHS = 4;
+	Registry* m_registry;
 	int		m_imageID;
 	bool	m_visible;
 	int		m_x;
@@ -190,6 +240,7 @@ private:
 	int		m_animationNumber;
 	int		m_direction;
 	double	m_size;
+	bool	m_dirty;
 
 	void moveALittle(double& from, double& to)
 	{
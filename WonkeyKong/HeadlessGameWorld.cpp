@@ -0,0 +1,21 @@
+#include "GameWorld.h"
+#include <string>
+using namespace std;
+
+// GameWorld services for builds without a GameController. There is no
+// window to show the status line in, no keyboard and no sound device, so
+// these are no-ops; scripted input is supplied through
+// StudentWorld::setInput() instead.
+
+void GameWorld::setGameStatText(string)
+{
+}
+
+bool GameWorld::getKey(int&)
+{
+    return false;
+}
+
+void GameWorld::playSound(int)
+{
+}
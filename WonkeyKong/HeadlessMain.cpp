@@ -0,0 +1,197 @@
+#include "Simulation.h"
+#include "Replay.h"
+#include "SelfCheck.h"
+#include "LevelGenerator.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+using namespace std;
+
+// Headless driver: runs whole game sessions through StudentWorld's
+// init/move/cleanUp cycle with no window, no GL and no tick throttling,
+// then reports how many ticks per second the simulation managed and how
+// each level went.
+//
+//   wonkykong_headless --assets DIR [--sessions N] [--threads N]
+//                      [--max-ticks N] [--level N] [--input none|random]
+//                      [--map WxH] [--seed S] [--record FILE | --replay FILE]
+//                      [--frames DIR [--frame-every N]]
+//   wonkykong_headless --assets DIR --check
+//
+// Session i seeds both its world and its random input with S + i, so any
+// run can be reproduced exactly, whatever the thread count. --map plays
+// levels generated at that size, such as 2000x2000, instead of the level
+// files. --record saves a single session as a replay file; --replay plays
+// one back unthrottled, taking the seed, starting level and map size from
+// the file. --frames renders every
+// Nth tick of each session with the software renderer and saves it in DIR
+// as a PPM image. --check replays a few fixed-seed batches and compares
+// their totals with those of the original game, exiting non-zero on any
+// difference.
+
+namespace
+{
+
+void usage(const char* argv0)
+{
+    cerr << "usage: " << argv0 << " --assets DIR [--sessions N] [--threads N] [--max-ticks N]"
+         << " [--level N] [--input none|random] [--map WxH] [--seed S] [--record FILE | --replay FILE]"
+         << " [--frames DIR [--frame-every N]]" << endl;
+    cerr << "       " << argv0 << " --assets DIR --check" << endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    SessionConfig config;
+    config.startLevel = 0;
+    config.maxTicks = 100000;
+    config.input = input_random;
+    config.mapWidth = config.mapHeight = 0;
+    config.frameEvery = 1;
+    int sessions = 1;
+    int threads = static_cast<int>(thread::hardware_concurrency());
+    uint64_t seed = 1;
+    string recordPath;
+    string replayPath;
+    bool check = false;
+    
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--check")
+        {
+            check = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--assets")
+            config.assetPath = value;
+        else if (arg == "--sessions")
+            sessions = atoi(value.c_str());
+        else if (arg == "--threads")
+            threads = atoi(value.c_str());
+        else if (arg == "--max-ticks")
+            config.maxTicks = atoll(value.c_str());
+        else if (arg == "--level")
+            config.startLevel = atoi(value.c_str());
+        else if (arg == "--input" && (value == "none" || value == "random"))
+            config.input = (value == "none" ? input_none : input_random);
+        else if (arg == "--map")
+        {
+            if (!parseMapSize(value, config.mapWidth, config.mapHeight))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--seed")
+            seed = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--record")
+            recordPath = value;
+        else if (arg == "--replay")
+            replayPath = value;
+        else if (arg == "--frames")
+            config.framePath = value;
+        else if (arg == "--frame-every")
+            config.frameEvery = atoll(value.c_str());
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (config.assetPath.empty() || sessions <= 0 || config.maxTicks <= 0 || config.frameEvery <= 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (check)
+        return runSelfChecks(config.assetPath, cout) == 0 ? 0 : 1;
+    if (threads <= 0)
+        threads = 1;
+    if ((!recordPath.empty() || !replayPath.empty()) && (sessions != 1 || !(recordPath.empty() || replayPath.empty())))
+    {
+        cerr << "--record and --replay each run a single session" << endl;
+        return 1;
+    }
+    
+    ReplayInput replay;
+    if (!replayPath.empty())
+    {
+        if (!replay.load(replayPath))
+        {
+            cerr << "Cannot read replay " << replayPath << endl;
+            return 1;
+        }
+        config.startLevel = replay.startLevel();
+        config.mapWidth = replay.mapWidth();
+        config.mapHeight = replay.mapHeight();
+        seed = replay.seed();
+        threads = 1;
+    }
+    
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    SimulationStats stats;
+    if (!replayPath.empty())
+        runSession(config, seed, stats, &replay);
+    else if (!recordPath.empty())
+    {
+        threads = 1;
+        if (runSession(config, seed, stats, nullptr, recordPath) == outcome_io_error &&
+            stats.outcomes[outcome_io_error] == 0)
+        {
+            cerr << "Cannot record a replay to " << recordPath << endl;
+            return 1;
+        }
+    }
+    else
+        stats = runSessions(config, sessions, seed, threads);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    if (stats.outcomes[outcome_level_error] > 0)
+    {
+        cerr << "A level file is malformed" << endl;
+        return 1;
+    }
+    if (stats.outcomes[outcome_io_error] > 0)
+    {
+        cerr << "Cannot write frames to " << config.framePath << endl;
+        return 1;
+    }
+    
+    cout << "sessions:    " << stats.sessions << endl;
+    cout << "threads:     " << threads << endl;
+    cout << "won:         " << stats.outcomes[outcome_won] << endl;
+    cout << "game over:   " << stats.outcomes[outcome_game_over] << endl;
+    cout << "tick limit:  " << stats.outcomes[outcome_tick_limit] << endl;
+    cout << "mean score:  " << static_cast<double>(stats.totalScore) / stats.sessions << endl;
+    cout << "ticks:       " << stats.ticks << endl;
+    cout << "seconds:     " << seconds << endl;
+    cout << "ticks/sec:   " << (seconds > 0 ? stats.ticks / seconds : 0) << endl;
+    if (!replayPath.empty())
+    {
+        cout << "final score: " << stats.totalScore << endl;
+        cout << "replay:      " << (replay.finished() && replay.missedEvents() == 0 ? "in sync" : "DIVERGED") << endl;
+    }
+    
+    cout << endl << "level  attempts  completed  deaths  mean ticks/attempt" << endl;
+    for (int level = 0; level <= MAX_LEVELS; level++)
+    {
+        const LevelStats& ls = stats.levels[level];
+        if (ls.attempts == 0)
+            continue;
+        cout << setw(5) << level << setw(10) << ls.attempts << setw(11) << ls.completions
+             << setw(8) << ls.deaths << setw(21) << static_cast<double>(ls.ticks) / ls.attempts << endl;
+    }
+}
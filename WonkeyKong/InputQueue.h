@@ -0,0 +1,175 @@
+#ifndef INPUTQUEUE_H_
+#define INPUTQUEUE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// InputQueue
+// Bounded single-producer/single-consumer queue of timestamped key events
+// between the window system's keyboard callbacks (producer) and the
+// simulation reading keys once per tick (consumer). Neither side ever
+// blocks or takes a lock, and keys pressed between two ticks queue up
+// instead of overwriting each other.
+//
+// The consumption policy decides what a tick sees when several keys are
+// waiting:
+//   consume_oldest   keys are delivered one per read, in order; nothing is
+//                    lost unless more than maxBacklog are waiting, in which
+//                    case the oldest are dropped so input never lags far
+//   consume_newest   the newest key is delivered and the older ones dropped
+// The default is consume_oldest with a backlog of DEFAULT_BACKLOG, so a
+// quick double tap still arrives whole, but the keys mashed while the
+// player is frozen or mid-jump, when nothing reads them, are not replayed
+// one per tick afterwards.
+//
+// Latency metrics measure from the key event to the read that delivers it,
+// and are kept by the consumer side.
+class InputQueue
+{
+  public:
+	enum Policy { consume_oldest, consume_newest };
+
+	static const int CAPACITY = 64;			// must be a power of two
+	static const int DEFAULT_BACKLOG = 2;
+	static const int NUM_LATENCY_BUCKETS = 16;	// bucket i counts latencies < 2^i ms; the last is open-ended
+
+	struct Metrics
+	{
+		std::uint64_t delivered;
+		std::uint64_t droppedFull;		// producer found the queue full
+		std::uint64_t droppedByPolicy;	// discarded by the consumption policy
+		std::int64_t  totalLatencyUs;
+		std::int64_t  maxLatencyUs;
+		std::uint64_t latencyBuckets[NUM_LATENCY_BUCKETS];
+
+		double meanLatencyUs() const
+		{
+			return delivered == 0 ? 0 : static_cast<double>(totalLatencyUs) / delivered;
+		}
+	};
+
+	InputQueue()
+	 : m_head(0), m_tail(0), m_policy(consume_oldest), m_maxBacklog(DEFAULT_BACKLOG),
+	   m_putBack(NO_KEY)
+	{
+		resetMetrics();
+	}
+
+	  // Producer side
+	bool push(int key)
+	{
+		std::uint32_t head = m_head.load(std::memory_order_relaxed);
+		std::uint32_t tail = m_tail.load(std::memory_order_acquire);
+		if (head - tail == CAPACITY)
+		{
+			m_droppedFull.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		Event& e = m_events[head & (CAPACITY - 1)];
+		e.key = key;
+		e.stampUs = nowUs();
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	  // Consumer side
+	bool pop(int& key)
+	{
+		if (m_putBack != NO_KEY)
+		{
+			key = m_putBack;
+			m_putBack = NO_KEY;
+			return true;
+		}
+
+		std::uint32_t tail = m_tail.load(std::memory_order_relaxed);
+		std::uint32_t head = m_head.load(std::memory_order_acquire);
+		if (head == tail)
+			return false;
+
+		std::uint32_t waiting = head - tail;
+		std::uint32_t skip = 0;
+		if (m_policy == consume_newest)
+			skip = waiting - 1;
+		else if (waiting > static_cast<std::uint32_t>(m_maxBacklog))
+			skip = waiting - m_maxBacklog;
+		tail += skip;
+		m_metrics.droppedByPolicy += skip;
+
+		const Event& e = m_events[tail & (CAPACITY - 1)];
+		key = e.key;
+		recordLatency(nowUs() - e.stampUs);
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	  // Consumer side: the next pop() returns key before anything queued
+	void putBack(int key)
+	{
+		m_putBack = key;
+	}
+
+	void setPolicy(Policy policy, int maxBacklog = DEFAULT_BACKLOG)
+	{
+		m_policy = policy;
+		m_maxBacklog = (maxBacklog < 1 ? 1 : maxBacklog);
+	}
+
+	Metrics metrics() const
+	{
+		Metrics m = m_metrics;
+		m.droppedFull = m_droppedFull.load(std::memory_order_relaxed);
+		return m;
+	}
+
+	void resetMetrics()
+	{
+		m_metrics = Metrics();
+		m_droppedFull.store(0, std::memory_order_relaxed);
+	}
+
+  private:
+	static const int NO_KEY = 0;
+
+	struct Event
+	{
+		int			 key;
+		std::int64_t stampUs;
+	};
+
+	static std::int64_t nowUs()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void recordLatency(std::int64_t us)
+	{
+		if (us < 0)
+			us = 0;
+		m_metrics.delivered++;
+		m_metrics.totalLatencyUs += us;
+		if (us > m_metrics.maxLatencyUs)
+			m_metrics.maxLatencyUs = us;
+		int bucket = 0;
+		for (std::int64_t ms = us / 1000; ms > 0 && bucket < NUM_LATENCY_BUCKETS - 1; ms >>= 1)
+			bucket++;
+		m_metrics.latencyBuckets[bucket]++;
+	}
+
+	  // Prevent copying or assigning InputQueues
+	InputQueue(const InputQueue&);
+	InputQueue& operator=(const InputQueue&);
+
+	Event						m_events[CAPACITY];
+	std::atomic<std::uint32_t>	m_head;		// written by the producer
+	std::atomic<std::uint32_t>	m_tail;		// written by the consumer
+	std::atomic<std::uint64_t>	m_droppedFull;
+	Policy						m_policy;
+	int							m_maxBacklog;
+	int							m_putBack;
+	Metrics						m_metrics;
+};
+
+#endif // INPUTQUEUE_H_
@@ -0,0 +1,17 @@
+#ifndef INPUTSOURCE_H_
+#define INPUTSOURCE_H_
+
+// InputSource
+// Where the player's key presses come from when they should not come from
+// the GameController's keyboard handling, e.g. a script in a headless run.
+class InputSource
+{
+public:
+    virtual ~InputSource() {}
+    
+    // Same contract as GameWorld::getKey: true and a KEY_PRESS_* value if a
+    // key is available on the given world tick, false otherwise
+    virtual bool getKey(long long tick, int& value) = 0;
+};
+
+#endif // INPUTSOURCE_H_
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 #include <cctype>
 
 class Level
@@ -19,22 +20,42 @@ public:
 		load_success, load_fail_file_not_found, load_fail_bad_format};
 
 	Level(std::string assetPath)
-	 : m_pathPrefix(assetPath)
+	 : m_width(0), m_height(0), m_pathPrefix(assetPath)
 	{
-		for (int y = 0; y < VIEW_HEIGHT; y++)
-			for (int x = 0; x < VIEW_WIDTH; x++)
-				m_maze[y][x] = empty;
+		resize(VIEW_WIDTH, VIEW_HEIGHT);
 
 		if (!m_pathPrefix.empty())
 			m_pathPrefix += '/';
 	}
 
+	  // Level files and catalogs hold VIEW_WIDTH x VIEW_HEIGHT boards; a
+	  // generated one can be any size, see generateLevel()
+	int width() const
+	{
+		return m_width;
+	}
+
+	int height() const
+	{
+		return m_height;
+	}
+
+	  // Empties the maze and gives it a new size
+	void resize(int width, int height)
+	{
+		m_width = width > 0 ? width : 0;
+		m_height = height > 0 ? height : 0;
+		m_maze.assign(static_cast<std::size_t>(m_width) * m_height, empty);
+	}
+
 	LoadResult loadLevel(std::string filename)
 	{
 		std::ifstream levelFile((m_pathPrefix + filename).c_str());
 		if (!levelFile)
 			return load_fail_file_not_found;
 
+		resize(VIEW_WIDTH, VIEW_HEIGHT);
+
 		  // get the maze
 
 		std::string line;
@@ -74,7 +95,40 @@ public:
 					case 'E':  me = extra_life; break;
 					case 'G':  me = garlic; break;
 				}
-				m_maze[y][x] = me;
+				setContentsOf(x, y, me);
+			}
+		}
+
+		if (numPlayers != 1  ||  numKongs != 1)
+			return load_fail_bad_format;
+
+		return load_success;
+	}
+
+	  // Loads a level compiled into a LevelCatalog: VIEW_WIDTH * VIEW_HEIGHT
+	  // MazeEntry bytes, row 0 first. A cell out of range or a wrong number of
+	  // players or Kongs means the catalog is corrupt.
+	LoadResult loadLevel(const unsigned char* cells)
+	{
+		if (cells == nullptr)
+			return load_fail_file_not_found;
+
+		resize(VIEW_WIDTH, VIEW_HEIGHT);
+		int numPlayers = 0;
+		int numKongs = 0;
+
+		for (int y = 0; y < VIEW_HEIGHT; y++)
+		{
+			for (int x = 0; x < VIEW_WIDTH; x++, cells++)
+			{
+				if (*cells > garlic)
+					return load_fail_bad_format;
+				MazeEntry me = static_cast<MazeEntry>(*cells);
+				if (me == player)
+					numPlayers++;
+				else if (me == left_kong  ||  me == right_kong)
+					numKongs++;
+				setContentsOf(x, y, me);
 			}
 		}
 
@@ -86,24 +140,33 @@ public:
 
 	MazeEntry getContentsOf(int x, int y) const
 	{
-		if (x < 0  ||  x >= VIEW_WIDTH  ||  y < 0  ||  y >= VIEW_HEIGHT)
+		if (x < 0  ||  x >= m_width  ||  y < 0  ||  y >= m_height)
 			return empty;
-		return m_maze[y][x];
+		return m_maze[static_cast<std::size_t>(y) * m_width + x];
+	}
+
+	void setContentsOf(int x, int y, MazeEntry me)
+	{
+		if (x < 0  ||  x >= m_width  ||  y < 0  ||  y >= m_height)
+			return;
+		m_maze[static_cast<std::size_t>(y) * m_width + x] = me;
 	}
 
 private:
 
-	MazeEntry	m_maze[VIEW_HEIGHT][VIEW_WIDTH];
+	int			m_width;
+	int			m_height;
+	std::vector<MazeEntry> m_maze;	// row-major, row 0 first
 	std::string m_pathPrefix;
 
 	bool edgesValid() const
 	{
-		for (int y = 0; y < VIEW_HEIGHT; y++)
-			if (m_maze[y][0] != floor || m_maze[y][VIEW_WIDTH-1] != floor)
+		for (int y = 0; y < m_height; y++)
+			if (getContentsOf(0, y) != floor || getContentsOf(m_width-1, y) != floor)
 				return false;
-		for (int x = 0; x < VIEW_WIDTH; x++)
-			if (m_maze[0][x] != floor ||
-					(m_maze[VIEW_HEIGHT-1][x] != floor && m_maze[VIEW_HEIGHT-1][x] != ladder))
+		for (int x = 0; x < m_width; x++)
+			if (getContentsOf(x, 0) != floor ||
+					(getContentsOf(x, m_height-1) != floor && getContentsOf(x, m_height-1) != ladder))
 				return false;
 
 		return true;
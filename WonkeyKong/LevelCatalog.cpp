@@ -0,0 +1,158 @@
+#include "LevelCatalog.h"
+#include "GameConstants.h"
+#include <cstring>
+#include <fstream>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+namespace
+{
+
+const char LEVEL_CATALOG_MAGIC[4] = {'W', 'K', 'L', 'V'};
+const size_t LEVEL_CELLS = VIEW_WIDTH * VIEW_HEIGHT;
+
+// Maps a whole file read-only, or returns nullptr
+#if defined(_WIN32)
+
+void* mapFile(const string& path, size_t& size)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+    
+    LARGE_INTEGER length;
+    void* data = nullptr;
+    if (GetFileSizeEx(file, &length) && length.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr)
+        {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);  // the view keeps the mapping alive
+        }
+        size = static_cast<size_t>(length.QuadPart);
+    }
+    CloseHandle(file);
+    return data;
+}
+
+void unmapFile(void* data, size_t)
+{
+    UnmapViewOfFile(data);
+}
+
+#else
+
+void* mapFile(const string& path, size_t& size)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        size = static_cast<size_t>(st.st_size);
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);  // the mapping stays valid on its own
+    return data == MAP_FAILED ? nullptr : data;
+}
+
+void unmapFile(void* data, size_t size)
+{
+    munmap(data, size);
+}
+
+#endif
+
+}  // namespace
+
+LevelCatalog::LevelCatalog()
+: m_data(nullptr), m_size(0), m_mapped(false), m_numLevels(0), m_writeTime(0)
+{}
+
+LevelCatalog::~LevelCatalog() {close();}
+
+bool LevelCatalog::open(const string& path)
+{
+    close();
+    
+    // Where the file cannot be mapped, reading it all is the fallback
+    size_t size = 0;
+    void* data = mapFile(path, size);
+    bool mapped = data != nullptr;
+    if (!mapped)
+    {
+        ifstream in(path, ios::binary | ios::ate);
+        if (!in) return false;
+        streamoff length = in.tellg();
+        if (length <= 0) return false;
+        m_buffer.resize(static_cast<size_t>(length));
+        in.seekg(0);
+        if (!in.read(reinterpret_cast<char*>(m_buffer.data()), length))
+        {
+            m_buffer.clear();
+            return false;
+        }
+        data = m_buffer.data();
+        size = m_buffer.size();
+    }
+    
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint32_t count = 0;
+    if (size >= HEADER_SIZE)
+        count = bytes[8] | (bytes[9] << 8) | (bytes[10] << 16) | (static_cast<uint32_t>(bytes[11]) << 24);
+    if (size < HEADER_SIZE || memcmp(bytes, LEVEL_CATALOG_MAGIC, sizeof(LEVEL_CATALOG_MAGIC)) != 0 ||
+        bytes[4] != LEVEL_CATALOG_VERSION || bytes[5] != VIEW_WIDTH || bytes[6] != VIEW_HEIGHT ||
+        (size - HEADER_SIZE) / LEVEL_CELLS < count)
+    {
+        if (mapped) unmapFile(data, size);
+        m_buffer.clear();
+        return false;
+    }
+    
+    m_data = data;
+    m_size = size;
+    m_mapped = mapped;
+    m_numLevels = static_cast<int>(count);
+    
+    // std::filesystem's clock needs macOS 10.15, and the Xcode target is 10.14
+    struct stat st;
+    m_writeTime = stat(path.c_str(), &st) == 0 ? st.st_mtime : 0;  // 0: trust no text file to be older
+    return true;
+}
+
+void LevelCatalog::close()
+{
+    if (m_mapped)
+        unmapFile(m_data, m_size);
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_numLevels = 0;
+}
+
+const uint8_t* LevelCatalog::levelCells(int n) const
+{
+    if (n < 0 || n >= m_numLevels) return nullptr;
+    return static_cast<const uint8_t*>(m_data) + HEADER_SIZE + n * LEVEL_CELLS;
+}
+
+bool LevelCatalog::isCurrent(int n, const string& textPath) const
+{
+    if (levelCells(n) == nullptr) return false;
+    
+    struct stat st;
+    return stat(textPath.c_str(), &st) != 0 || st.st_mtime <= m_writeTime;
+}
@@ -0,0 +1,73 @@
+#ifndef LEVELCATALOG_H_
+#define LEVELCATALOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Level catalog files
+// Every level of a game compiled ahead of time into one binary image, so
+// loading a level is a bounds check and a 400-byte copy instead of parsing
+// text. The catalog is memory-mapped, with mmap() or, on Windows,
+// MapViewOfFile(), so opening it reads only the header; where mapping fails
+// the whole file is read into memory instead.
+//
+//   "WKLV"                     magic
+//   u8       version           LEVEL_CATALOG_VERSION
+//   u8       width             VIEW_WIDTH
+//   u8       height            VIEW_HEIGHT
+//   u8       reserved          0
+//   u32 LE   level count
+//   levels 0 .. count-1, each width * height bytes:
+//     one Level::MazeEntry per cell, row y = 0 first, x ascending
+//
+// Catalogs are built from the levelNN.txt files by wonkykong_levelc, which
+// stops at the first missing level, just as the game does. A catalog that
+// is older than a level's text file is stale for that level, and the text
+// file is loaded instead, so an edited level is never shadowed by a catalog
+// nobody rebuilt.
+
+const std::uint8_t LEVEL_CATALOG_VERSION = 1;
+const char LEVEL_CATALOG_NAME[] = "levels.wkl";
+
+// LevelCatalog
+// Read-only view of a catalog file.
+class LevelCatalog
+{
+public:
+    LevelCatalog();
+    ~LevelCatalog();
+    
+    // Fails, leaving the catalog closed, if the file is missing, its header
+    // does not match this build or it is shorter than its level count says
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const {return m_data != nullptr;}
+    
+    int numLevels() const {return m_numLevels;}
+    
+    // The cells of level n, or nullptr when the catalog has no such level
+    const std::uint8_t* levelCells(int n) const;
+    
+    // Whether level n is in the catalog and textPath, the level's text file,
+    // is missing or no newer than the catalog
+    bool isCurrent(int n, const std::string& textPath) const;
+    
+    static const std::size_t HEADER_SIZE = 12;
+    
+private:
+    void* m_data;
+    std::size_t m_size;
+    bool m_mapped;                      // otherwise m_data points into m_buffer
+    std::vector<std::uint8_t> m_buffer;
+    int m_numLevels;
+    std::time_t m_writeTime;
+    
+      // Prevent copying or assigning LevelCatalogs
+    LevelCatalog(const LevelCatalog&);
+    LevelCatalog& operator=(const LevelCatalog&);
+};
+
+#endif // LEVELCATALOG_H_
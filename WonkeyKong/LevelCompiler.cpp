@@ -0,0 +1,74 @@
+#include "Level.h"
+#include "LevelCatalog.h"
+#include "GameConstants.h"
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+  // Level compiler: turns the levelNN.txt files in an asset directory into
+  // the binary catalog the game maps at startup.
+  //
+  //   wonkykong_levelc ASSETS_DIR [OUTPUT]
+  //
+  // OUTPUT defaults to ASSETS_DIR/levels.wkl. Levels are read from level00
+  // upwards until one is missing; a level that does not parse fails the
+  // whole build rather than producing a catalog the text loader would not.
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        cerr << "usage: " << argv[0] << " ASSETS_DIR [OUTPUT]" << endl;
+        return 1;
+    }
+    
+    string assetPath = argv[1];
+    string outPath = argc == 3 ? argv[2] : assetPath + "/" + LEVEL_CATALOG_NAME;
+    
+    vector<uint8_t> cells;
+    uint32_t count = 0;
+    for (int n = 0; n <= MAX_LEVELS; n++, count++)
+    {
+        ostringstream levName;
+        levName.fill('0');
+        levName << "level" << setw(2) << n << ".txt";
+        
+        Level lev(assetPath);
+        Level::LoadResult result = lev.loadLevel(levName.str());
+        if (result == Level::load_fail_file_not_found)
+            break;
+        if (result == Level::load_fail_bad_format)
+        {
+            cerr << levName.str() << ": bad level format" << endl;
+            return 1;
+        }
+        
+        for (int y = 0; y < VIEW_HEIGHT; y++)
+            for (int x = 0; x < VIEW_WIDTH; x++)
+                cells.push_back(static_cast<uint8_t>(lev.getContentsOf(x, y)));
+    }
+    
+    ofstream out(outPath.c_str(), ios::out | ios::binary | ios::trunc);
+    out.write("WKLV", 4);
+    out.put(static_cast<char>(LEVEL_CATALOG_VERSION));
+    out.put(static_cast<char>(VIEW_WIDTH));
+    out.put(static_cast<char>(VIEW_HEIGHT));
+    out.put(0);
+    for (int i = 0; i < 4; i++)
+        out.put(static_cast<char>((count >> (8 * i)) & 0xff));
+    out.write(reinterpret_cast<const char*>(cells.data()), cells.size());
+    out.close();
+    if (!out)
+    {
+        cerr << "Cannot write " << outPath << endl;
+        return 1;
+    }
+    
+    cout << "Compiled " << count << " level" << (count == 1 ? "" : "s") << " into " << outPath << endl;
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "LevelGenerator.h"
+#include "Level.h"
+#include "Rng.h"
+#include <cstdio>
+using namespace std;
+
+namespace
+{
+
+// Nothing but floor is put this close to the player's start
+const int START_CLEARANCE = 8;
+
+bool nearStart(int x, int y)
+{
+    return x < 2 + START_CLEARANCE && y < 1 + START_CLEARANCE;
+}
+
+}  // namespace
+
+void generateLevel(Level& lev, int width, int height, uint64_t seed)
+{
+    Rng rng(seed);
+    lev.resize(width, height);
+    
+    // The border, then a floor every LEVEL_GEN_SPACING rows below the top
+    // row, each with a gap of one or two cells every 16 to 48 cells
+    for (int x = 0; x < width; x++)
+    {
+        lev.setContentsOf(x, 0, Level::floor);
+        lev.setContentsOf(x, height - 1, Level::floor);
+    }
+    for (int y = 0; y < height; y++)
+    {
+        lev.setContentsOf(0, y, Level::floor);
+        lev.setContentsOf(width - 1, y, Level::floor);
+    }
+    int top = 0;
+    for (int y = LEVEL_GEN_SPACING; y + 2 < height - 1; y += LEVEL_GEN_SPACING)
+    {
+        top = y;
+        int gap = rng.randInt(16, 48);
+        for (int x = 1; x < width - 1; x++)
+        {
+            if (--gap <= 0)
+            {
+                x += rng.randInt(0, 1);
+                gap = rng.randInt(16, 48);
+                continue;
+            }
+            lev.setContentsOf(x, y, Level::floor);
+        }
+    }
+    
+    // Ladders up from every floor but the top one, every 12 to 25 cells,
+    // running through the floor above as they do in the shipped levels
+    for (int y = 0; y < top; y += LEVEL_GEN_SPACING)
+    {
+        for (int x = rng.randInt(3, 14); x < width - 1; x += rng.randInt(12, 25))
+        {
+            for (int dy = 1; dy <= LEVEL_GEN_SPACING; dy++)
+                lev.setContentsOf(x, y + dy, Level::ladder);
+        }
+    }
+    
+    // Actors stand on floors, clear of ladders
+    for (int y = 1; y < height - 1; y++)
+    {
+        for (int x = 1; x < width - 1; x++)
+        {
+            if (lev.getContentsOf(x, y) != Level::empty || lev.getContentsOf(x, y - 1) != Level::floor ||
+                nearStart(x, y))
+                continue;
+            
+            int r = rng.randInt(0, 511);
+            if (r < 8)
+                lev.setContentsOf(x, y, Level::fireball);
+            else if (r < 16)
+                lev.setContentsOf(x, y, Level::koopa);
+            else if (r < 18)
+                lev.setContentsOf(x, y, Level::bonfire);
+            else if (r == 18)
+                lev.setContentsOf(x, y, rng.randInt(0, 1) == 0 ? Level::extra_life : Level::garlic);
+        }
+    }
+    
+    lev.setContentsOf(2, 1, Level::player);
+    int kongX = rng.randInt(1, width - 2);
+    while (lev.getContentsOf(kongX, top) != Level::floor)
+        kongX = kongX % (width - 2) + 1;
+    lev.setContentsOf(kongX, top + 1, rng.randInt(0, 1) == 0 ? Level::left_kong : Level::right_kong);
+}
+
+bool parseMapSize(const string& text, int& width, int& height)
+{
+    int w, h;
+    char extra;
+    if (sscanf(text.c_str(), "%dx%d%c", &w, &h, &extra) != 2)
+        return false;
+    if (w < VIEW_WIDTH || h < VIEW_HEIGHT || w > LEVEL_GEN_MAX_SIZE || h > LEVEL_GEN_MAX_SIZE)
+        return false;
+    
+    width = w;
+    height = h;
+    return true;
+}
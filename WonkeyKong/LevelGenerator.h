@@ -0,0 +1,28 @@
+#ifndef LEVELGENERATOR_H_
+#define LEVELGENERATOR_H_
+
+#include <cstdint>
+#include <string>
+
+class Level;
+
+// Generated levels
+// Boards too large to draw by hand, built from a seed: a floor every
+// LEVEL_GEN_SPACING rows with the odd gap, ladders joining each floor to the
+// next, the player at the bottom left and Kong on the top floor. Enemies
+// stand on about one floor cell in 32, bonfires on one in 256 and goodies on
+// one in 512, none of them near the player's start. The same size and seed
+// always give the same level.
+
+const int LEVEL_GEN_SPACING = 4;
+const int LEVEL_GEN_MAX_SIZE = 16384;   // per side
+
+// Replaces lev's maze with a width x height generated level; both must be
+// at least VIEW_WIDTH x VIEW_HEIGHT
+void generateLevel(Level& lev, int width, int height, std::uint64_t seed);
+
+// Parses a map size written as WxH, such as 2000x2000. Sizes smaller than
+// VIEW_WIDTH x VIEW_HEIGHT or larger than LEVEL_GEN_MAX_SIZE are refused.
+bool parseMapSize(const std::string& text, int& width, int& height);
+
+#endif // LEVELGENERATOR_H_
@@ -0,0 +1,73 @@
+#include "LevelPrefetcher.h"
+#include "LevelCatalog.h"
+#include "LevelGenerator.h"
+#include <iomanip>
+#include <sstream>
+#include <utility>
+using namespace std;
+
+LevelPrefetcher::LevelPrefetcher(string assetPath, const LevelCatalog& catalog)
+: m_assetPath(std::move(assetPath)), m_catalog(&catalog), m_pendingLevel(-1),
+  m_genWidth(0), m_genHeight(0), m_genSeed(0)
+{}
+
+LevelPrefetcher::~LevelPrefetcher()
+{
+    // The worker reads the catalog, so it has to finish before we go
+    if (m_pending.valid())
+        m_pending.wait();
+}
+
+void LevelPrefetcher::prefetch(int n)
+{
+    if (m_pending.valid())
+    {
+        if (m_pendingLevel == n) return;
+        m_pending.wait();
+    }
+    m_pendingLevel = n;
+    m_pending = async(launch::async, [this, n] {return load(n);});
+}
+
+void LevelPrefetcher::setGenerated(int width, int height, uint64_t seed)
+{
+    m_genWidth = width;
+    m_genHeight = height;
+    m_genSeed = seed;
+}
+
+unique_ptr<Level> LevelPrefetcher::take(int n, Level::LoadResult& result)
+{
+    Staged staged;
+    if (m_pending.valid() && m_pendingLevel == n)
+        staged = m_pending.get();
+    else
+        staged = load(n);
+    
+    result = staged.result;
+    if (result != Level::load_success)
+        staged.level.reset();
+    return std::move(staged.level);
+}
+
+LevelPrefetcher::Staged LevelPrefetcher::load(int n) const
+{
+    Staged staged;
+    staged.level.reset(new Level(m_assetPath));
+    if (m_genWidth > 0)
+    {
+        generateLevel(*staged.level, m_genWidth, m_genHeight, m_genSeed + n);
+        staged.result = Level::load_success;
+        return staged;
+    }
+    
+    ostringstream levName;
+    levName.fill('0');
+    levName << "level" << setw(2) << n << ".txt";
+    string textPath = m_assetPath.empty() ? levName.str() : m_assetPath + "/" + levName.str();
+    if (m_catalog->isCurrent(n, textPath))
+        staged.result = staged.level->loadLevel(m_catalog->levelCells(n));
+    else
+        staged.result = staged.level->loadLevel(levName.str());
+    return staged;
+}
@@ -0,0 +1,57 @@
+#ifndef LEVELPREFETCHER_H_
+#define LEVELPREFETCHER_H_
+
+#include "Level.h"
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+
+class LevelCatalog;
+
+// LevelPrefetcher
+// Loads levels on a worker thread so that moving on to the next level does
+// not wait for the disk. prefetch(n) starts loading level n in the
+// background; take(n) hands over the staged level, waiting for it if it is
+// still loading, or loads it on the spot if level n was never prefetched.
+// Levels come from the catalog when it holds a current copy of the level
+// and from the text files otherwise, unless setGenerated() asks for
+// generated ones. The catalog must outlive the prefetcher.
+class LevelPrefetcher
+{
+public:
+    LevelPrefetcher(std::string assetPath, const LevelCatalog& catalog);
+    ~LevelPrefetcher();
+    
+    void prefetch(int n);
+    
+    // Makes level n a width x height level generated from seed + n from now
+    // on; call it before the first prefetch() or take()
+    void setGenerated(int width, int height, std::uint64_t seed);
+    
+    // Returns nullptr, with result saying why, if level n cannot be loaded
+    std::unique_ptr<Level> take(int n, Level::LoadResult& result);
+    
+private:
+    struct Staged
+    {
+        Level::LoadResult result;
+        std::unique_ptr<Level> level;
+    };
+    
+    std::string m_assetPath;
+    const LevelCatalog* m_catalog;
+    std::future<Staged> m_pending;
+    int m_pendingLevel;
+    int m_genWidth;                 // 0 to load the level files
+    int m_genHeight;
+    std::uint64_t m_genSeed;
+    
+    Staged load(int n) const;
+    
+      // Prevent copying or assigning LevelPrefetchers
+    LevelPrefetcher(const LevelPrefetcher&);
+    LevelPrefetcher& operator=(const LevelPrefetcher&);
+};
+
+#endif // LEVELPREFETCHER_H_
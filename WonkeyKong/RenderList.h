@@ -0,0 +1,262 @@
+#ifndef RENDERLIST_H_
+#define RENDERLIST_H_
+
+#include "GraphObject.h"
+#include "SpriteManager.h"
+#include "TileLayer.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+  // RenderList
+  // One frame of sprites as a flat array, sorted into drawing order. Each
+  // image's depth and frame handles are resolved once, in setImage(), so
+  // build() does no map lookups. Commands are sorted by depth (deepest first,
+  // so nearer images are painted over them) and then by atlas page, keeping
+  // the SpriteManager's batches as long as possible.
+  //
+  // The list is retained from frame to frame. Every graph object keeps the
+  // quad it was last drawn with, and build() redoes the placement math only
+  // for objects marked dirty since then; the tile layer's quads are kept
+  // until its revision changes. When nothing at all has changed, the list
+  // is not re-sorted and draw() has the SpriteManager redraw the previous
+  // frame's vertex data, so it must be the only thing plotting through that
+  // SpriteManager.
+  //
+  // Only the window of board cells set by setView() is drawn: objects outside
+  // it get no quad, and only the tiles inside it are visited, so a board much
+  // larger than the window costs little more to draw than one that fits.
+class RenderList
+{
+public:
+
+	struct Command
+	{
+		std::uint64_t key;  // depth, then atlas page, then build order
+		const SpriteManager::Quad* quad;
+	};
+
+	RenderList()
+	 : m_tiles(nullptr), m_tileRevision(0), m_atlasRevision(0), m_viewX(0), m_viewY(0),
+	   m_viewWidth(VIEW_WIDTH), m_viewHeight(VIEW_HEIGHT), m_stale(true), m_changed(true)
+	{
+	}
+
+	  // Draws only the cells from (x, y) to (x + width - 1, y + height - 1);
+	  // moving the window redoes every quad
+	void setView(int x, int y, int width, int height)
+	{
+		if (x == m_viewX && y == m_viewY && width == m_viewWidth && height == m_viewHeight)
+			return;
+
+		m_viewX = x;
+		m_viewY = y;
+		m_viewWidth = width;
+		m_viewHeight = height;
+		m_stale = true;
+	}
+
+	  // Records an image's depth and resolves its frames; call once the
+	  // image's frames have all been loaded into the SpriteManager
+	void setImage(const SpriteManager& sprites, int imageID, int depth)
+	{
+		if (imageID < 0)
+			return;
+
+		if (imageID >= static_cast<int>(m_images.size()))
+			m_images.resize(imageID + 1);
+
+		ImageInfo& info = m_images[imageID];
+		info.depth = depth < 0 ? 0 : (depth > MAX_DEPTH ? MAX_DEPTH : depth);
+		info.frames.clear();
+		for (int frame = 0; frame < sprites.getNumFrames(imageID); frame++)
+			info.frames.push_back(sprites.getSpriteHandle(imageID, frame));
+		m_stale = true;
+	}
+
+	  // Brings the list up to date with the objects and tiles, animating each
+	  // changed object to its latest location on the way; toGl(x, y, gx, gy, gz)
+	  // converts a board location to the coordinates plotSprite() takes
+	template <typename F>
+	void build(const GraphObject::Registry& objects, const TileLayer* tiles, SpriteManager& sprites, F toGl)
+	{
+		unsigned int atlasRevision = sprites.getAtlasRevision();
+		bool stale = m_stale || atlasRevision != m_atlasRevision;
+		m_atlasRevision = atlasRevision;
+		m_stale = false;
+		bool changed = stale;
+
+		  // The registry and the previous instances are both in pointer order,
+		  // so one merge pass pairs each object with its last quad
+		std::less<GraphObject*> before;
+		m_scratch.clear();
+		auto old = m_instances.begin();
+		for (GraphObject* obj : objects)
+		{
+			while (old != m_instances.end() && before(old->obj, obj))
+			{
+				++old;
+				changed = true;  // destroyed
+			}
+
+			bool known = old != m_instances.end() && old->obj == obj;
+			if (known)
+				++old;
+			if (known && !stale && !obj->isDirty())
+			{
+				m_scratch.push_back(*(old - 1));
+				continue;
+			}
+
+			changed = true;
+			obj->clearDirty();
+			Instance inst;
+			inst.obj = obj;
+			inst.visible = false;
+			if (obj->isVisible())
+			{
+				obj->animate();
+				const ImageInfo* info = findImage(obj->getID());
+				double x, y;
+				obj->getAnimationLocation(x, y);
+				if (info != nullptr && inView(x, y))
+				{
+					int frame = obj->getAnimationNumber() % info->frames.size();
+					inst.visible = place(sprites, *info, info->frames[frame], x, y, obj->getDirection(), obj->getSize(), toGl, inst);
+				}
+			}
+			m_scratch.push_back(inst);
+		}
+		if (old != m_instances.end())
+			changed = true;
+		if (changed)
+			m_instances.swap(m_scratch);  // otherwise identical, and m_commands points into it
+
+		if (stale || tiles != m_tiles || (tiles != nullptr && tiles->revision() != m_tileRevision))
+		{
+			changed = true;
+			m_tiles = tiles;
+			m_tileInstances.clear();
+			if (tiles != nullptr)
+			{
+				m_tileRevision = tiles->revision();
+				tiles->forEachTileIn(m_viewX, m_viewY, m_viewX + m_viewWidth - 1, m_viewY + m_viewHeight - 1,
+									 [&](int imageID, int x, int y) {
+					const ImageInfo* info = findImage(imageID);
+					Instance inst;
+					inst.obj = nullptr;
+					if (info != nullptr && place(sprites, *info, info->frames[0], x, y, GraphObject::right, 1.0, toGl, inst))
+						m_tileInstances.push_back(inst);
+				});
+			}
+		}
+
+		if (!changed)
+			return;
+
+		m_changed = true;
+		m_commands.clear();
+		for (const Instance& inst : m_instances)
+			if (inst.visible)
+				addCommand(inst);
+		for (const Instance& inst : m_tileInstances)
+			addCommand(inst);
+		std::sort(m_commands.begin(), m_commands.end(),
+				  [](const Command& a, const Command& b) { return a.key < b.key; });
+	}
+
+	  // Plots every command in order and flushes, or repeats the last frame
+	  // if build() found nothing new
+	void draw(SpriteManager& sprites)
+	{
+		if (!m_changed)
+		{
+			sprites.redraw();
+			return;
+		}
+
+		for (const Command& cmd : m_commands)
+			sprites.plotQuad(*cmd.quad);
+		sprites.flush();
+		m_changed = false;
+	}
+
+	const std::vector<Command>& commands() const
+	{
+		return m_commands;
+	}
+
+private:
+
+	struct ImageInfo
+	{
+		int depth;
+		std::vector<int> frames;  // SpriteManager handles
+	};
+
+	struct Instance
+	{
+		GraphObject* obj;          // null for tiles
+		bool visible;
+		std::uint32_t order;       // depth, then atlas page
+		SpriteManager::Quad quad;
+	};
+
+	static const int MAX_DEPTH = 0xFFFF;
+
+	std::vector<ImageInfo> m_images;         // by image ID
+	std::vector<Instance>  m_instances;      // graph objects, in registry order
+	std::vector<Instance>  m_scratch;
+	std::vector<Instance>  m_tileInstances;
+	std::vector<Command>   m_commands;
+	const TileLayer*       m_tiles;
+	unsigned int           m_tileRevision;
+	unsigned int           m_atlasRevision;
+	int                    m_viewX;          // see setView()
+	int                    m_viewY;
+	int                    m_viewWidth;
+	int                    m_viewHeight;
+	bool                   m_stale;          // every quad must be redone
+	bool                   m_changed;        // m_commands differs from the last frame drawn
+
+	const ImageInfo* findImage(int imageID) const
+	{
+		if (imageID < 0 || imageID >= static_cast<int>(m_images.size()) || m_images[imageID].frames.empty())
+			return nullptr;
+
+		return &m_images[imageID];
+	}
+
+	  // Whether any of the cell at (x, y) shows in the window
+	bool inView(double x, double y) const
+	{
+		return x > m_viewX - 1 && x < m_viewX + m_viewWidth && y > m_viewY - 1 && y < m_viewY + m_viewHeight;
+	}
+
+	template <typename F>
+	static bool place(SpriteManager& sprites, const ImageInfo& info, int handle, double x, double y,
+					  int angle, double size, F& toGl, Instance& inst)
+	{
+		if (handle == SpriteManager::INVALID_SPRITE_HANDLE)
+			return false;
+
+		double gx, gy, gz;
+		toGl(x, y, gx, gy, gz);
+		if (!sprites.makeQuad(handle, gx, gy, gz, angle, size, inst.quad))
+			return false;
+
+		inst.order = (std::uint32_t(MAX_DEPTH - info.depth) << 16) | static_cast<std::uint16_t>(inst.quad.page);
+		return true;
+	}
+
+	void addCommand(const Instance& inst)
+	{
+		Command cmd;
+		cmd.key = (std::uint64_t(inst.order) << 32) | m_commands.size();
+		cmd.quad = &inst.quad;
+		m_commands.push_back(cmd);
+	}
+};
+
+#endif // RENDERLIST_H_
@@ -0,0 +1,153 @@
+#include "Replay.h"
+#include "GameConstants.h"
+#include <cstring>
+#include <iterator>
+using namespace std;
+
+namespace
+{
+
+const char REPLAY_MAGIC[4] = {'W', 'K', 'R', 'P'};
+
+// Keys with a one-byte encoding; anything else is stored raw
+const int REPLAY_KEYS[] = {
+    KEY_PRESS_LEFT, KEY_PRESS_RIGHT, KEY_PRESS_UP, KEY_PRESS_DOWN,
+    KEY_PRESS_SPACE, KEY_PRESS_TAB
+};
+const int REPLAY_NUM_KEYS = sizeof(REPLAY_KEYS) / sizeof(REPLAY_KEYS[0]);
+const unsigned int REPLAY_RAW_KEY = 7;
+
+bool readVarint(const vector<unsigned char>& data, size_t& pos, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < data.size(); shift += 7)
+    {
+        unsigned char byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+// ReplayRecorder Implementation
+ReplayRecorder::ReplayRecorder(const string& path, uint64_t seed, int startLevel, int mapWidth, int mapHeight)
+: m_file(path.c_str(), ios::out | ios::binary | ios::trunc), m_lastTick(0)
+{
+    if (!m_file) return;
+    m_file.write(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    m_file.put(static_cast<char>(REPLAY_VERSION));
+    for (int i = 0; i < 8; i++)
+        m_file.put(static_cast<char>((seed >> (8 * i)) & 0xff));
+    writeVarint(static_cast<uint64_t>(startLevel));
+    writeVarint(static_cast<uint64_t>(mapWidth));
+    writeVarint(static_cast<uint64_t>(mapHeight));
+}
+
+void ReplayRecorder::record(long long tick, int key)
+{
+    unsigned int code = REPLAY_RAW_KEY;
+    for (int i = 0; i < REPLAY_NUM_KEYS; i++)
+    {
+        if (REPLAY_KEYS[i] == key)
+        {
+            code = i;
+            break;
+        }
+    }
+    
+    writeVarint((static_cast<uint64_t>(tick - m_lastTick) << 3) | code);
+    if (code == REPLAY_RAW_KEY)
+        writeVarint(static_cast<uint64_t>(static_cast<uint32_t>(key)));
+    m_lastTick = tick;
+}
+
+void ReplayRecorder::writeVarint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        m_file.put(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    m_file.put(static_cast<char>(value));
+}
+
+// ReplayInput Implementation
+ReplayInput::ReplayInput()
+: m_next(0), m_seed(0), m_startLevel(0), m_mapWidth(0), m_mapHeight(0), m_missed(0)
+{}
+
+bool ReplayInput::load(const string& path)
+{
+    ifstream file(path.c_str(), ios::in | ios::binary);
+    if (!file) return false;
+    vector<unsigned char> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    
+    const size_t headerSize = sizeof(REPLAY_MAGIC) + 1 + 8;
+    if (data.size() < headerSize || memcmp(data.data(), REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0)
+        return false;
+    unsigned int version = data[sizeof(REPLAY_MAGIC)];
+    if (version < 1 || version > REPLAY_VERSION)
+        return false;
+    
+    size_t pos = sizeof(REPLAY_MAGIC) + 1;
+    m_seed = 0;
+    for (int i = 0; i < 8; i++)
+        m_seed |= static_cast<uint64_t>(data[pos++]) << (8 * i);
+    
+    uint64_t value;
+    if (!readVarint(data, pos, value)) return false;
+    m_startLevel = static_cast<int>(value);
+    m_mapWidth = m_mapHeight = 0;
+    if (version >= 2)
+    {
+        if (!readVarint(data, pos, value)) return false;
+        m_mapWidth = static_cast<int>(value);
+        if (!readVarint(data, pos, value)) return false;
+        m_mapHeight = static_cast<int>(value);
+    }
+    
+    m_ticks.clear();
+    m_keys.clear();
+    long long tick = 0;
+    while (pos < data.size())
+    {
+        if (!readVarint(data, pos, value)) return false;
+        tick += static_cast<long long>(value >> 3);
+        unsigned int code = static_cast<unsigned int>(value & 7);
+        int key;
+        if (code == REPLAY_RAW_KEY)
+        {
+            uint64_t raw;
+            if (!readVarint(data, pos, raw)) return false;
+            key = static_cast<int>(static_cast<uint32_t>(raw));
+        }
+        else if (code < static_cast<unsigned int>(REPLAY_NUM_KEYS))
+            key = REPLAY_KEYS[code];
+        else
+            return false;
+        m_ticks.push_back(tick);
+        m_keys.push_back(key);
+    }
+    
+    m_next = 0;
+    m_missed = 0;
+    return true;
+}
+
+bool ReplayInput::getKey(long long tick, int& value)
+{
+    while (m_next < m_ticks.size() && m_ticks[m_next] < tick)
+    {
+        m_next++;
+        m_missed++;
+    }
+    if (m_next < m_ticks.size() && m_ticks[m_next] == tick)
+    {
+        value = m_keys[m_next++];
+        return true;
+    }
+    return false;
+}
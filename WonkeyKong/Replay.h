@@ -0,0 +1,84 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include "InputSource.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Replay files
+// A session is reproduced exactly by its RNG seed, its starting level, the
+// size of its generated maps if it played any, and the keys the player
+// consumed, each tagged with the world tick it was read on.
+//
+//   "WKRP"                     magic
+//   u8       version           REPLAY_VERSION
+//   u64 LE   seed
+//   varint   start level
+//   varint   map width         0 for the level files; absent in version 1
+//   varint   map height        absent in version 1
+//   events, until end of file:
+//     varint (tickDelta << 3) | code
+//     varint key               only when code == REPLAY_RAW_KEY
+//
+// tickDelta counts from the previous event (from tick 0 for the first), and
+// code indexes REPLAY_KEYS, so a typical event takes a single byte. Varints
+// are unsigned LEB128.
+
+const std::uint8_t REPLAY_VERSION = 2;
+
+// ReplayRecorder
+// Appends every key the player consumes to a replay file. Events are
+// buffered by the stream; flush() makes everything so far durable.
+class ReplayRecorder
+{
+public:
+    ReplayRecorder(const std::string& path, std::uint64_t seed, int startLevel, int mapWidth = 0, int mapHeight = 0);
+    bool isOpen() const {return m_file.is_open() && m_file.good();}
+    void record(long long tick, int key);
+    void flush() {m_file.flush();}
+    
+private:
+    std::ofstream m_file;
+    long long m_lastTick;
+    
+    void writeVarint(std::uint64_t value);
+};
+
+// ReplayInput
+// Plays a replay file back as an InputSource: on the tick an event was
+// recorded at, the player reads the recorded key; on every other tick it
+// reads nothing. There is no pacing, so playback runs as fast as the world
+// can be stepped.
+class ReplayInput : public InputSource
+{
+public:
+    ReplayInput();
+    bool load(const std::string& path);
+    std::uint64_t seed() const {return m_seed;}
+    int startLevel() const {return m_startLevel;}
+    
+    // Both 0 if the session played the level files
+    int mapWidth() const {return m_mapWidth;}
+    int mapHeight() const {return m_mapHeight;}
+    
+    // Events whose tick passed without the player asking for a key, which
+    // means the run has diverged from the recording
+    long long missedEvents() const {return m_missed;}
+    bool finished() const {return m_next >= m_ticks.size();}
+    
+    virtual bool getKey(long long tick, int& value);
+    
+private:
+    std::vector<long long> m_ticks;
+    std::vector<int> m_keys;
+    std::size_t m_next;
+    std::uint64_t m_seed;
+    int m_startLevel;
+    int m_mapWidth;
+    int m_mapHeight;
+    long long m_missed;
+};
+
+#endif // REPLAY_H_
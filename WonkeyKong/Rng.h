@@ -0,0 +1,68 @@
+#ifndef RNG_H_
+#define RNG_H_
+
+#include <cstdint>
+#include <utility>
+
+// Rng
+// A small PCG32 generator (O'Neill, XSH-RR output) owned by each world.
+// It is explicitly seeded, holds no shared state, and its whole state is two
+// integers, so runs replay bit for bit and worlds on different threads never
+// contend with each other.
+class Rng
+{
+public:
+    explicit Rng(std::uint64_t seed = 0) {reseed(seed);}
+    
+    void reseed(std::uint64_t seed)
+    {
+        m_state = 0;
+        m_inc = (seed << 1) | 1;
+        next();
+        m_state += 0x853c49e6748fea9bULL ^ seed;
+        next();
+    }
+    
+    std::uint32_t next()
+    {
+        std::uint64_t old = m_state;
+        m_state = old * 6364136223846793005ULL + m_inc;
+        std::uint32_t xorshifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+        std::uint32_t rot = static_cast<std::uint32_t>(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+    
+    // Uniformly distributed int from min to max, inclusive. Uses Lemire's
+    // multiply-and-shift reduction, which only needs a division on the rare
+    // rejection path.
+    int randInt(int min, int max)
+    {
+        if (max < min)
+            std::swap(max, min);
+        std::uint32_t range = static_cast<std::uint32_t>(static_cast<std::int64_t>(max) - min) + 1;
+        if (range == 0)
+            return static_cast<int>(next());
+        std::uint64_t m = static_cast<std::uint64_t>(next()) * range;
+        std::uint32_t low = static_cast<std::uint32_t>(m);
+        if (low < range)
+        {
+            std::uint32_t threshold = (0u - range) % range;
+            while (low < threshold)
+            {
+                m = static_cast<std::uint64_t>(next()) * range;
+                low = static_cast<std::uint32_t>(m);
+            }
+        }
+        return static_cast<int>(static_cast<std::int64_t>(min) + static_cast<std::int64_t>(m >> 32));
+    }
+    
+    // Full generator state, for saving and restoring a run
+    void getState(std::uint64_t& state, std::uint64_t& inc) const {state = m_state; inc = m_inc;}
+    void setState(std::uint64_t state, std::uint64_t inc) {m_state = state; m_inc = inc | 1;}
+    
+private:
+    std::uint64_t m_state;
+    std::uint64_t m_inc;
+};
+
+#endif // RNG_H_
@@ -0,0 +1,442 @@
+#include "SelfCheck.h"
+#include "Simulation.h"
+#include "StudentWorld.h"
+#include "InputSource.h"
+#include "ChunkGrid.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+using namespace std;
+
+namespace
+{
+
+// One batch of seeded sessions and the totals the original game produced
+struct BatchCheck
+{
+    const char* name;
+    int sessions;
+    uint64_t seed;
+    InputMode input;
+    long long maxTicks;
+    long long outcomes[NUM_OUTCOMES];
+    long long totalScore;
+    long long ticks;
+};
+
+const BatchCheck batchChecks[] = {
+    // Random keys: the player wanders into barrels and fireballs and every
+    // session ends in a game over, so any change in when actors meet the
+    // player moves the scores and the tick counts.
+    { "random input", 1000, 1, input_random, 100000, {0, 1000, 0, 0, 0}, 70625, 1125866 },
+    // No keys: the player stands still, so this covers the barrels, burps
+    // and drops that enemies leave without the player's help.
+    { "no input", 4, 7, input_none, 20000, {0, 0, 4, 0, 0}, 39200, 80000 },
+};
+
+bool sameTotals(const SimulationStats& a, const SimulationStats& b)
+{
+    for (int i = 0; i < NUM_OUTCOMES; i++)
+        if (a.outcomes[i] != b.outcomes[i])
+            return false;
+    return a.sessions == b.sessions && a.totalScore == b.totalScore && a.ticks == b.ticks;
+}
+
+void report(ostream& out, const char* name, bool passed, const SimulationStats& stats)
+{
+    out << (passed ? "PASS  " : "FAIL  ") << name << ": " << stats.sessions << " sessions, "
+        << stats.outcomes[outcome_game_over] << " game over, " << stats.outcomes[outcome_tick_limit]
+        << " at tick limit, score " << stats.totalScore << ", " << stats.ticks << " ticks" << endl;
+}
+
+// One enemy next to the player on a bare floor, and what should happen
+// once the player has had a single key press
+struct ContactCheck
+{
+    const char* name;
+    char enemy;             // 'F' or 'K', as in a level file
+    int enemyDirection;
+    bool stepRight;         // whether the player steps into the enemy's cell
+    bool playerDies;        // otherwise the player should be frozen
+};
+
+const ContactCheck contactChecks[] = {
+    // The player and the fireball swap cells in the same tick
+    { "fireball swap", 'F', GraphObject::left, true, true },
+    // The player steps into the fireball's cell as it moves on
+    { "fireball step-in", 'F', GraphObject::right, true, true },
+    // The fireball walks into the player's cell
+    { "fireball walks in", 'F', GraphObject::left, false, true },
+    { "koopa swap", 'K', GraphObject::left, true, false },
+    { "koopa step-in", 'K', GraphObject::right, true, false },
+};
+
+// Presses RIGHT once, on the first tick it is asked, if told to
+class StepInput : public InputSource
+{
+public:
+    StepInput(bool step) : m_step(step) {}
+    
+    virtual bool getKey(long long, int& value)
+    {
+        if (!m_step) return false;
+        m_step = false;
+        value = KEY_PRESS_RIGHT;
+        return true;
+    }
+    
+private:
+    bool m_step;
+};
+
+// Writes a level00.txt with the player at (5,1), the enemy at (6,1) and the
+// Kong every level needs out of the way in the top corner
+bool writeContactLevel(const string& dir, char enemy)
+{
+    ofstream level(dir + "/level00.txt");
+    for (int y = VIEW_HEIGHT - 1; y >= 0; y--)
+    {
+        string row(VIEW_WIDTH, y == 0 ? '@' : ' ');
+        if (y == VIEW_HEIGHT - 2)
+            row[VIEW_WIDTH - 2] = '<';
+        else if (y == 1)
+        {
+            row[5] = 'P';
+            row[6] = enemy;
+        }
+        level << row << '\n';
+    }
+    return static_cast<bool>(level);
+}
+
+// Plays the first tick of each contact scenario, with the enemy turned to
+// face the way the scenario needs. These are the cases a single check at
+// the end of the tick misses: the enemy looks for the player both before
+// and after it moves.
+int runContactChecks(ostream& out)
+{
+    error_code ec;
+    filesystem::path dir = filesystem::temp_directory_path(ec) /
+        ("wonkykong_check_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+    if (ec || !filesystem::create_directories(dir, ec))
+    {
+        out << "FAIL  contact checks: cannot create " << dir.string() << endl;
+        return 1;
+    }
+    
+    int failures = 0;
+    for (const ContactCheck& check : contactChecks)
+    {
+        bool passed = false;
+        if (writeContactLevel(dir.string(), check.enemy))
+        {
+            GraphObject::Registry graphObjects;
+            StepInput input(check.stepRight);
+            StudentWorld world(dir.string(), 1, graphObjects);
+            world.setInput(&input);
+            if (world.init() == GWSTATUS_CONTINUE_GAME)
+            {
+                WorldSnapshot snapshot;
+                world.saveSnapshot(snapshot);
+                for (ActorState& state : snapshot.actors)
+                    if (state.x == 6 && state.y == 1)
+                        state.direction = check.enemyDirection;
+                world.restoreSnapshot(snapshot);
+                
+                int status = world.move();
+                world.saveSnapshot(snapshot);
+                if (check.playerDies)
+                    passed = (status == GWSTATUS_PLAYER_DIED);
+                else
+                    passed = (status == GWSTATUS_CONTINUE_GAME && snapshot.player.counters[1] == 50);
+            }
+            world.cleanUp();
+        }
+        out << (passed ? "PASS  " : "FAIL  ") << check.name << endl;
+        if (!passed)
+            failures++;
+    }
+    
+    filesystem::remove_all(dir, ec);
+    return failures;
+}
+
+// Presses the given keys, each on its own tick
+class ScriptedInput : public InputSource
+{
+public:
+    struct Press
+    {
+        long long tick;
+        int key;
+    };
+    
+    ScriptedInput(const Press* presses, size_t count) : m_presses(presses), m_count(count) {}
+    
+    virtual bool getKey(long long tick, int& value)
+    {
+        for (size_t i = 0; i < m_count; i++)
+        {
+            if (m_presses[i].tick == tick)
+            {
+                value = m_presses[i].key;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+private:
+    const Press* m_presses;
+    size_t m_count;
+};
+
+// The player picks up the garlic at (6,9), walks to the end of the floor
+// and burps to the right on tick 198. The Kong's barrel from tick 200 falls
+// into the burp's cell on tick 201, after the burp, which is older, has
+// already taken that tick's turn, so the barrel survives and the score is
+// the garlic's alone.
+const ScriptedInput::Press burpPresses[] = {
+    { 1, KEY_PRESS_RIGHT },
+    { 2, KEY_PRESS_RIGHT },
+    { 198, KEY_PRESS_TAB },
+};
+const long long BURP_CHECK_TICKS = 201;
+const int BURP_CHECK_SCORE = 25;
+
+bool writeBurpLevel(const string& dir)
+{
+    ofstream level(dir + "/level00.txt");
+    for (int y = VIEW_HEIGHT - 1; y >= 0; y--)
+    {
+        string row(VIEW_WIDTH, ' ');
+        if (y == 10)
+            row[10] = '<';
+        else if (y == 9)
+        {
+            row[5] = 'P';
+            row[6] = 'G';
+        }
+        else if (y == 8)
+        {
+            for (int x = 1; x <= 7; x++)
+                row[x] = '@';
+        }
+        level << row << '\n';
+    }
+    return static_cast<bool>(level);
+}
+
+// Burps attack on their own turns, in creation order, so an enemy that
+// moves into a burp's cell after the burp has gone is not hit until the
+// burp's next turn
+int runBurpCheck(ostream& out)
+{
+    error_code ec;
+    filesystem::path dir = filesystem::temp_directory_path(ec) /
+        ("wonkykong_burp_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+    if (ec || !filesystem::create_directories(dir, ec))
+    {
+        out << "FAIL  burp turn order: cannot create " << dir.string() << endl;
+        return 1;
+    }
+    
+    bool passed = false;
+    int score = 0;
+    if (writeBurpLevel(dir.string()))
+    {
+        GraphObject::Registry graphObjects;
+        ScriptedInput input(burpPresses, sizeof(burpPresses) / sizeof(burpPresses[0]));
+        StudentWorld world(dir.string(), 1, graphObjects);
+        world.setInput(&input);
+        if (world.init() == GWSTATUS_CONTINUE_GAME)
+        {
+            int status = GWSTATUS_CONTINUE_GAME;
+            while (status == GWSTATUS_CONTINUE_GAME && world.tick() < BURP_CHECK_TICKS)
+                status = world.move();
+            score = world.getScore();
+            passed = status == GWSTATUS_CONTINUE_GAME && score == BURP_CHECK_SCORE;
+        }
+        world.cleanUp();
+    }
+    out << (passed ? "PASS  " : "FAIL  ") << "burp turn order: score " << score << endl;
+    
+    filesystem::remove_all(dir, ec);
+    return passed ? 0 : 1;
+}
+
+// A generated map many chunks across, played with no input from the
+// player's start in the bottom left corner
+const int LOD_CHECK_SIZE = 300;
+const long long LOD_CHECK_TICKS = 100;
+
+bool sameState(const ActorState& a, const ActorState& b)
+{
+    return a.x == b.x && a.y == b.y && a.direction == b.direction && a.animationNumber == b.animationNumber &&
+        a.dead == b.dead && a.counters[0] == b.counters[0] && a.counters[1] == b.counters[1] &&
+        a.counters[2] == b.counters[2];
+}
+
+// Actors further than lodRadius chunks from the player must not think at
+// all, so nothing about them may change, while those in the active chunks
+// around the player carry on
+int runLodCheck(ostream& out)
+{
+    GraphObject::Registry graphObjects;
+    StepInput input(false);
+    StudentWorld world("", 1, graphObjects);
+    world.setInput(&input);
+    world.useGeneratedLevels(LOD_CHECK_SIZE, LOD_CHECK_SIZE);
+    if (world.init() != GWSTATUS_CONTINUE_GAME)
+    {
+        out << "FAIL  far chunks frozen: cannot start a generated level" << endl;
+        return 1;
+    }
+    
+    WorldSnapshot before, after;
+    world.saveSnapshot(before);
+    int status = GWSTATUS_CONTINUE_GAME;
+    while (status == GWSTATUS_CONTINUE_GAME && world.tick() < LOD_CHECK_TICKS)
+        status = world.move();
+    world.saveSnapshot(after);
+    world.cleanUp();
+    
+    map<unsigned int, const ActorState*> later;
+    for (const ActorState& state : after.actors)
+        later[state.serial] = &state;
+    
+    ChunkGrid::Config config = ChunkGrid::defaultConfig();
+    int far = 0, farChanged = 0, near = 0, nearChanged = 0;
+    for (const ActorState& state : before.actors)
+    {
+        int distance = max(abs(state.x / config.chunkSize - before.player.x / config.chunkSize),
+                           abs(state.y / config.chunkSize - before.player.y / config.chunkSize));
+        map<unsigned int, const ActorState*>::const_iterator it = later.find(state.serial);
+        bool changed = it == later.end() || !sameState(state, *it->second);
+        if (distance > config.lodRadius)
+        {
+            far++;
+            if (changed)
+                farChanged++;
+        }
+        else if (distance <= config.activeRadius)
+        {
+            near++;
+            if (changed)
+                nearChanged++;
+        }
+    }
+    
+    bool passed = status == GWSTATUS_CONTINUE_GAME && far > 0 && farChanged == 0 && nearChanged > 0;
+    out << (passed ? "PASS  " : "FAIL  ") << "far chunks frozen: " << farChanged << " of " << far
+        << " far actors changed, " << nearChanged << " of " << near << " near" << endl;
+    return passed ? 0 : 1;
+}
+
+// Ways a caller could hand restoreSnapshot() a snapshot that does not fit
+// together; each must be refused before the world is touched
+void dropGroup(WorldSnapshot& s) {s.groupSizes.pop_back();}
+void growGroup(WorldSnapshot& s) {s.groupSizes.back()++;}
+void cutOccupancy(WorldSnapshot& s) {s.occupancy.resize(s.occupancy.size() / 2);}
+
+void pointPastActors(WorldSnapshot& s)
+{
+    // The first occupied cell's first actor index
+    size_t i = 0;
+    while (i < s.occupancy.size() && s.occupancy[i] == 0)
+        i++;
+    if (i + 1 < s.occupancy.size())
+        s.occupancy[i + 1] = static_cast<int>(s.actors.size());
+}
+
+struct SnapshotDamage
+{
+    const char* name;
+    void (*damage)(WorldSnapshot& s);
+};
+
+const SnapshotDamage snapshotDamages[] = {
+    { "missing group", dropGroup },
+    { "group too large", growGroup },
+    { "occupancy cut short", cutOccupancy },
+    { "occupancy past the actors", pointPastActors },
+};
+
+// Plays a while on the shipped level, then checks that each damaged copy of
+// a snapshot is refused without changing the world, and that the intact
+// snapshot is accepted
+int runSnapshotChecks(const string& assetPath, ostream& out)
+{
+    GraphObject::Registry graphObjects;
+    StudentWorld world(assetPath, 1, graphObjects);
+    if (world.init() != GWSTATUS_CONTINUE_GAME)
+    {
+        out << "FAIL  snapshot checks: cannot start level 0" << endl;
+        return 1;
+    }
+    for (int i = 0; i < 300 && world.move() == GWSTATUS_CONTINUE_GAME; i++)
+        ;
+    
+    WorldSnapshot saved, after;
+    world.saveSnapshot(saved);
+    int failures = 0;
+    for (const SnapshotDamage& d : snapshotDamages)
+    {
+        WorldSnapshot damaged = saved;
+        d.damage(damaged);
+        bool passed = !world.restoreSnapshot(damaged);
+        world.saveSnapshot(after);
+        passed = passed && after.tick == saved.tick && after.actors.size() == saved.actors.size() &&
+            after.occupancy == saved.occupancy;
+        out << (passed ? "PASS  " : "FAIL  ") << "snapshot refused: " << d.name << endl;
+        if (!passed)
+            failures++;
+    }
+    
+    bool passed = world.restoreSnapshot(saved);
+    out << (passed ? "PASS  " : "FAIL  ") << "snapshot accepted" << endl;
+    world.cleanUp();
+    return failures + (passed ? 0 : 1);
+}
+
+}  // namespace
+
+int runSelfChecks(const string& assetPath, ostream& out)
+{
+    int failures = 0;
+    for (const BatchCheck& check : batchChecks)
+    {
+        SessionConfig config;
+        config.assetPath = assetPath;
+        config.startLevel = 0;
+        config.maxTicks = check.maxTicks;
+        config.input = check.input;
+        config.mapWidth = config.mapHeight = 0;
+        config.frameEvery = 1;
+        
+        SimulationStats expected;
+        expected.sessions = check.sessions;
+        expected.totalScore = check.totalScore;
+        expected.ticks = check.ticks;
+        for (int i = 0; i < NUM_OUTCOMES; i++)
+            expected.outcomes[i] = check.outcomes[i];
+        
+        SimulationStats serial = runSessions(config, check.sessions, check.seed, 1);
+        bool passed = sameTotals(serial, expected);
+        report(out, check.name, passed, serial);
+        if (!passed)
+            failures++;
+        
+        // The totals must not depend on how the sessions are spread over threads
+        SimulationStats threaded = runSessions(config, check.sessions, check.seed, 4);
+        passed = sameTotals(threaded, serial);
+        report(out, (string(check.name) + ", 4 threads").c_str(), passed, threaded);
+        if (!passed)
+            failures++;
+    }
+    return failures + runContactChecks(out) + runBurpCheck(out) + runLodCheck(out) + runSnapshotChecks(assetPath, out);
+}
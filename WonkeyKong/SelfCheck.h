@@ -0,0 +1,23 @@
+#ifndef SELFCHECK_H_
+#define SELFCHECK_H_
+
+#include <iostream>
+#include <string>
+
+// Fixed-seed regression checks for the headless driver. Each one plays a
+// few batches of sessions on the shipped level00 and compares the totals
+// with figures recorded from the original game code, the one that scanned
+// every actor on every query, run with the same seeded RNG and input. Any
+// change to tick order or to when actors meet shows up as a different
+// score or tick count. A second set plays single ticks on a one-row level
+// where the player and a fireball or Koopa swap cells, or the player steps
+// into the enemy's cell as it moves on, and checks the player is hit. One
+// more has a barrel fall into a burp's cell after the burp's turn and
+// checks the barrel is spared, as it was in the original game. Another
+// plays a generated map many chunks across and checks that nothing far from
+// the player changes. A last set hands StudentWorld::restoreSnapshot()
+// damaged snapshots and checks each is refused.
+// Each result is written to out; returns the number of checks that failed.
+int runSelfChecks(const std::string& assetPath, std::ostream& out);
+
+#endif // SELFCHECK_H_
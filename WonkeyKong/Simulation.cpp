@@ -0,0 +1,226 @@
+#include "Simulation.h"
+#include "StudentWorld.h"
+#include "InputSource.h"
+#include "SoftwareRenderer.h"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+using namespace std;
+
+namespace
+{
+
+// Presses a pseudo-random key on roughly half the ticks
+class RandomInput : public InputSource
+{
+public:
+    RandomInput(uint64_t seed) : m_state(static_cast<uint32_t>(seed ^ (seed >> 32)))
+    {
+        if (m_state == 0) m_state = 1;
+    }
+    
+
+    virtual bool getKey(long long, int& value)
+    {
+        static const int keys[] = {
+            KEY_PRESS_LEFT, KEY_PRESS_RIGHT, KEY_PRESS_UP, KEY_PRESS_DOWN,
+            KEY_PRESS_SPACE, KEY_PRESS_TAB
+        };
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        uint32_t r = m_state % 12;
+        if (r >= 6)
+            return false;
+        value = keys[r];
+        return true;
+    }
+    
+private:
+    uint32_t m_state;
+};
+
+// Never presses anything
+class NullInput : public InputSource
+{
+public:
+    virtual bool getKey(long long, int&) {return false;}
+};
+
+// Nearest images first, as the display draws them
+void setImageDepths(SoftwareRenderer& renderer)
+{
+    renderer.setImageDepth(IID_PLAYER, 0);
+    renderer.setImageDepth(IID_KONG, 1);
+    renderer.setImageDepth(IID_BARREL, 1);
+    renderer.setImageDepth(IID_FIREBALL, 1);
+    renderer.setImageDepth(IID_KOOPA, 1);
+    renderer.setImageDepth(IID_BURP, 1);
+    renderer.setImageDepth(IID_EXTRA_LIFE_GOODIE, 2);
+    renderer.setImageDepth(IID_GARLIC_GOODIE, 2);
+    renderer.setImageDepth(IID_BONFIRE, 2);
+    renderer.setImageDepth(IID_FLOOR, 3);
+    renderer.setImageDepth(IID_LADDER, 3);
+}
+
+// Saves the frame for tick if one is due; false if it could not be written
+bool captureFrame(SoftwareRenderer* renderer, const SessionConfig& config, const GraphObject::Registry& objects,
+                  const StudentWorld& world, uint64_t seed, long long tick)
+{
+    if (renderer == nullptr || tick % config.frameEvery != 0)
+        return true;
+    char name[64];
+    snprintf(name, sizeof(name), "/s%llu_t%08lld.ppm", static_cast<unsigned long long>(seed), tick);
+    int viewX, viewY;
+    world.getViewOrigin(viewX, viewY);
+    renderer->renderFrame(objects, world.tileLayer(), viewX, viewY);
+    return renderer->savePPM(config.framePath + name);
+}
+
+}  // namespace
+
+SimulationStats::SimulationStats()
+ : sessions(0), ticks(0), totalScore(0)
+{
+    for (int i = 0; i < NUM_OUTCOMES; i++)
+        outcomes[i] = 0;
+    for (int i = 0; i <= MAX_LEVELS; i++)
+        levels[i] = LevelStats{0, 0, 0, 0};
+}
+
+void SimulationStats::merge(const SimulationStats& other)
+{
+    sessions += other.sessions;
+    ticks += other.ticks;
+    totalScore += other.totalScore;
+    for (int i = 0; i < NUM_OUTCOMES; i++)
+        outcomes[i] += other.outcomes[i];
+    for (int i = 0; i <= MAX_LEVELS; i++)
+    {
+        levels[i].attempts += other.levels[i].attempts;
+        levels[i].completions += other.levels[i].completions;
+        levels[i].deaths += other.levels[i].deaths;
+        levels[i].ticks += other.levels[i].ticks;
+    }
+}
+
+// Mirrors GameController's state machine without the prompts between levels
+Outcome runSession(const SessionConfig& config, uint64_t seed, SimulationStats& stats,
+                   InputSource* input, const string& recordPath)
+{
+    GraphObject::Registry graphObjects;
+    RandomInput randomInput(seed);
+    NullInput nullInput;
+    if (input == nullptr)
+        input = (config.input == input_random ? static_cast<InputSource*>(&randomInput) : &nullInput);
+    
+    StudentWorld world(config.assetPath, seed, graphObjects);
+    world.setInput(input);
+    if (config.mapWidth > 0)
+        world.useGeneratedLevels(config.mapWidth, config.mapHeight);
+    for (int i = 0; i < config.startLevel; i++)
+        world.advanceToNextLevel();
+    if (!recordPath.empty() && !world.startRecording(recordPath))
+        return outcome_io_error;
+    
+    unique_ptr<SoftwareRenderer> renderer;
+    if (!config.framePath.empty())
+    {
+        renderer.reset(new SoftwareRenderer);
+        setImageDepths(*renderer);
+    }
+    bool framesSaved = true;
+    
+    long long ticks = 0;
+    int status = world.init();
+    if (status == GWSTATUS_CONTINUE_GAME)
+    {
+        stats.levels[world.getLevel()].attempts++;
+        framesSaved = captureFrame(renderer.get(), config, graphObjects, world, seed, ticks);
+    }
+    while (status == GWSTATUS_CONTINUE_GAME && ticks < config.maxTicks && framesSaved)
+    {
+        LevelStats& level = stats.levels[world.getLevel()];
+        status = world.move();
+        ticks++;
+        level.ticks++;
+        if (status == GWSTATUS_CONTINUE_GAME)
+        {
+            framesSaved = captureFrame(renderer.get(), config, graphObjects, world, seed, ticks);
+            continue;
+        }
+        
+        if (status == GWSTATUS_PLAYER_DIED)
+        {
+            level.deaths++;
+            world.cleanUp();
+            if (world.isGameOver())
+                break;
+        }
+        else if (status == GWSTATUS_FINISHED_LEVEL)
+        {
+            level.completions++;
+            world.cleanUp();
+            world.advanceToNextLevel();
+        }
+        status = world.init();
+        if (status == GWSTATUS_CONTINUE_GAME)
+            stats.levels[world.getLevel()].attempts++;
+    }
+    
+    Outcome outcome;
+    switch (status)
+    {
+        case GWSTATUS_PLAYER_WON:
+            outcome = outcome_won;
+            break;
+        case GWSTATUS_PLAYER_DIED:
+            outcome = outcome_game_over;
+            break;
+        case GWSTATUS_LEVEL_ERROR:
+            outcome = outcome_level_error;
+            break;
+        default:
+            outcome = outcome_tick_limit;
+            break;
+    }
+    if (!framesSaved)
+        outcome = outcome_io_error;
+    world.cleanUp();
+    
+    stats.sessions++;
+    stats.ticks += ticks;
+    stats.totalScore += world.getScore();
+    stats.outcomes[outcome]++;
+    return outcome;
+}
+
+SimulationStats runSessions(const SessionConfig& config, int sessions, uint64_t seed, int threads)
+{
+    if (threads < 1)
+        threads = 1;
+    if (threads > sessions)
+        threads = sessions;
+    
+    atomic<int> next(0);
+    vector<SimulationStats> perThread(threads);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&config, &next, &perThread, sessions, seed, t]()
+        {
+            for (int s = next.fetch_add(1); s < sessions; s = next.fetch_add(1))
+                runSession(config, seed + s, perThread[t]);
+        });
+    }
+    
+    SimulationStats total;
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].join();
+        total.merge(perThread[t]);
+    }
+    return total;
+}
@@ -0,0 +1,67 @@
+#ifndef SIMULATION_H_
+#define SIMULATION_H_
+
+#include "GameConstants.h"
+#include <cstdint>
+#include <string>
+
+class InputSource;
+
+// Batch simulation of whole game sessions, with no window and no tick
+// throttling. Each session owns its StudentWorld, graph object registry,
+// RNG and input, so sessions run on as many threads as asked for without
+// sharing any mutable state.
+
+enum InputMode { input_none, input_random };
+
+struct SessionConfig
+{
+    std::string assetPath;
+    int startLevel;
+    long long maxTicks;     // give up on a session after this many ticks
+    InputMode input;
+    int mapWidth;           // if non-zero, play generated levels of this size
+    int mapHeight;          // instead of the level files
+    std::string framePath;  // if set, a directory to save rendered frames in
+    long long frameEvery;   // save every this many ticks, counting from the first init()
+};
+
+enum Outcome {
+    outcome_won, outcome_game_over, outcome_tick_limit, outcome_level_error, outcome_io_error,
+    NUM_OUTCOMES
+};
+
+// What happened on one level, summed over every session that played it
+struct LevelStats
+{
+    long long attempts;     // lives started on the level
+    long long completions;
+    long long deaths;
+    long long ticks;
+};
+
+struct SimulationStats
+{
+    SimulationStats();
+    void merge(const SimulationStats& other);
+    
+    long long sessions;
+    long long ticks;
+    long long totalScore;
+    long long outcomes[NUM_OUTCOMES];
+    LevelStats levels[MAX_LEVELS + 1];
+};
+
+// Plays one session seeded with seed, adding its results to stats. Keys come
+// from input if given, otherwise from config.input; a non-empty recordPath
+// saves the session as a replay file. Frames are saved as
+// <framePath>/s<seed>_t<tick>.ppm, and a frame that cannot be written makes
+// the outcome outcome_io_error.
+Outcome runSession(const SessionConfig& config, std::uint64_t seed, SimulationStats& stats,
+                   InputSource* input = nullptr, const std::string& recordPath = "");
+
+// Plays sessions 0..sessions-1 on a pool of threads; session i is seeded with
+// seed + i, so the totals do not depend on the thread count
+SimulationStats runSessions(const SessionConfig& config, int sessions, std::uint64_t seed, int threads);
+
+#endif // SIMULATION_H_
@@ -0,0 +1,292 @@
+#include "SoftwareRenderer.h"
+#include "TileLayer.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+using namespace std;
+
+namespace
+{
+
+  // Nearest source texel for texel i of n spread over a source of length len
+int sampleAt(int i, int n, int len)
+{
+    return static_cast<int>((2 * static_cast<long long>(i) + 1) * len / (2 * static_cast<long long>(n)));
+}
+
+}  // namespace
+
+SoftwareRenderer::SoftwareRenderer(int cellSize)
+: m_cellSize(max(cellSize, 1)), m_width(VIEW_WIDTH * m_cellSize), m_height(VIEW_HEIGHT * m_cellSize),
+  m_pixels(static_cast<size_t>(m_width) * m_height)
+{
+    clear();
+}
+
+bool SoftwareRenderer::loadSprite(const string& filenameTga, int imageID, int frame)
+{
+    if (imageID < 0 || frame < 0)
+        return false;
+
+    ifstream file(filenameTga.c_str(), ios::in | ios::binary);
+    unsigned char header[18];
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)))
+        return false;
+
+    // Uncompressed colour (2) or greyscale (3), 24 or 32 bits, no colour map
+    int width = header[12] | header[13] << 8;
+    int height = header[14] | header[15] << 8;
+    int bytes = header[16] / 8;
+    if (header[1] != 0 || (header[2] != 2 && header[2] != 3) || (bytes != 3 && bytes != 4) ||
+        width == 0 || height == 0)
+        return false;
+
+    vector<unsigned char> data(static_cast<size_t>(width) * height * bytes);
+    file.seekg(sizeof(header) + header[0]);
+    if (!file.read(reinterpret_cast<char*>(data.data()), data.size()))
+        return false;
+
+    Sprite sprite;
+    sprite.width = width;
+    sprite.height = height;
+    sprite.pixels.resize(static_cast<size_t>(width) * height);
+    bool topFirst = (header[17] & 0x20) != 0;
+    const unsigned char* src = data.data();
+    for (int row = 0; row < height; row++)
+    {
+        uint32_t* dst = &sprite.pixels[static_cast<size_t>(topFirst ? row : height - 1 - row) * width];
+        for (int x = 0; x < width; x++, src += bytes)
+        {
+            uint32_t alpha = (bytes == 4 ? src[3] : 255);
+            dst[x] = src[2] | src[1] << 8 | src[0] << 16 | alpha << 24;
+        }
+    }
+
+    if (imageID >= static_cast<int>(m_sprites.size()))
+        m_sprites.resize(imageID + 1);
+    vector<Sprite>& frames = m_sprites[imageID];
+    if (frame >= static_cast<int>(frames.size()))
+        frames.resize(frame + 1, Sprite{0, 0, vector<uint32_t>()});
+    frames[frame] = std::move(sprite);
+    return true;
+}
+
+int SoftwareRenderer::numFrames(int imageID) const
+{
+    if (imageID < 0 || imageID >= static_cast<int>(m_sprites.size()))
+        return 0;
+    return static_cast<int>(m_sprites[imageID].size());
+}
+
+void SoftwareRenderer::setImageDepth(int imageID, int depth)
+{
+    if (imageID < 0)
+        return;
+    if (imageID >= static_cast<int>(m_depths.size()))
+        m_depths.resize(imageID + 1, 0);
+    m_depths[imageID] = depth;
+}
+
+void SoftwareRenderer::clear(uint32_t color)
+{
+    fill(m_pixels.begin(), m_pixels.end(), color | 0xff000000);
+    m_plots.clear();
+}
+
+void SoftwareRenderer::plotSprite(int imageID, int frame, double x, double y, int depth, int angleDegrees, double size)
+{
+    double side = size * m_cellSize;
+    double centerX = (x + 0.5) * m_cellSize;
+    double centerY = (VIEW_HEIGHT - y - 0.5) * m_cellSize;
+
+    Plot plot;
+    plot.depth = depth;
+    plot.imageID = imageID;
+    plot.frame = frame;
+    plot.side = max(1, static_cast<int>(lround(side)));
+    plot.left = static_cast<int>(lround(centerX - plot.side / 2.0));
+    plot.top = static_cast<int>(lround(centerY - plot.side / 2.0));
+    plot.quarter = ((static_cast<int>(lround(angleDegrees / 90.0)) % 4) + 4) % 4;
+    m_plots.push_back(plot);
+}
+
+void SoftwareRenderer::flush()
+{
+    stable_sort(m_plots.begin(), m_plots.end(),
+                [](const Plot& a, const Plot& b) {return a.depth > b.depth;});
+    for (const Plot& plot : m_plots)
+        draw(plot);
+    m_plots.clear();
+}
+
+void SoftwareRenderer::renderFrame(const GraphObject::Registry& objects, const TileLayer* tiles, int viewX, int viewY)
+{
+    auto depthOf = [this](int imageID) {
+        return imageID >= 0 && imageID < static_cast<int>(m_depths.size()) ? m_depths[imageID] : 0;
+    };
+
+    clear();
+    for (GraphObject* obj : objects)
+    {
+        int x = obj->getX() - viewX;
+        int y = obj->getY() - viewY;
+        if (!obj->isVisible() || x < 0 || x >= VIEW_WIDTH || y < 0 || y >= VIEW_HEIGHT)
+            continue;
+        int imageID = obj->getID();
+        int frames = numFrames(imageID);
+        int frame = (frames > 0 ? static_cast<int>(obj->getAnimationNumber() % frames) : 0);
+        plotSprite(imageID, frame, x, y, depthOf(imageID), obj->getDirection(), obj->getSize());
+    }
+    if (tiles != nullptr)
+    {
+        tiles->forEachTileIn(viewX, viewY, viewX + VIEW_WIDTH - 1, viewY + VIEW_HEIGHT - 1, [&](int imageID, int x, int y) {
+            plotSprite(imageID, 0, x - viewX, y - viewY, depthOf(imageID), GraphObject::right, 1.0);
+        });
+    }
+    flush();
+}
+
+const SoftwareRenderer::Sprite* SoftwareRenderer::findSprite(int imageID, int frame) const
+{
+    if (imageID < 0 || imageID >= static_cast<int>(m_sprites.size()))
+        return nullptr;
+    const vector<Sprite>& frames = m_sprites[imageID];
+    if (frame < 0 || frame >= static_cast<int>(frames.size()) || frames[frame].width == 0)
+        return nullptr;
+    return &frames[frame];
+}
+
+void SoftwareRenderer::draw(const Plot& plot)
+{
+    int x0 = max(plot.left, 0);
+    int x1 = min(plot.left + plot.side, m_width);
+    int y0 = max(plot.top, 0);
+    int y1 = min(plot.top + plot.side, m_height);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    const Sprite* sprite = findSprite(plot.imageID, plot.frame);
+    if (sprite == nullptr)
+    {
+        // Inset by a pixel so neighbouring placeholders stay apart
+        uint32_t color = placeholderColor(plot.imageID);
+        int inset = (plot.side > 2 ? 1 : 0);
+        x0 = max(x0, plot.left + inset);
+        x1 = min(x1, plot.left + plot.side - inset);
+        for (int y = max(y0, plot.top + inset); y < min(y1, plot.top + plot.side - inset); y++)
+            fill(&m_pixels[static_cast<size_t>(y) * m_width + x0], &m_pixels[static_cast<size_t>(y) * m_width + x1], color);
+        return;
+    }
+
+    // Work in the sprite's own frame, y up: (u, v) is the texel under pixel
+    // (i, j) of the plot, i from the left and j from the bottom. Along a
+    // framebuffer row one of u and v varies and the other is fixed, so each
+    // row is a table lookup from a fixed base.
+    int side = plot.side;
+    int width = sprite->width;
+    int height = sprite->height;
+    bool alongRow = (plot.quarter % 2 == 0);   // u varies along the row
+    m_index.resize(side);
+    for (int i = 0; i < side; i++)
+    {
+        switch (plot.quarter)
+        {
+            case 0: m_index[i] = sampleAt(i, side, width); break;
+            case 2: m_index[i] = sampleAt(side - 1 - i, side, width); break;
+            case 1: m_index[i] = (height - 1 - sampleAt(side - 1 - i, side, height)) * width; break;
+            default: m_index[i] = (height - 1 - sampleAt(i, side, height)) * width; break;
+        }
+    }
+
+    int count = x1 - x0;
+    m_row.resize(count);
+    const int* index = &m_index[x0 - plot.left];
+    for (int y = y0; y < y1; y++)
+    {
+        int j = plot.top + side - 1 - y;
+        int base;
+        if (alongRow)
+            base = (height - 1 - sampleAt(j, side, height)) * width;
+        else
+            base = sampleAt(plot.quarter == 1 ? j : side - 1 - j, side, width);
+
+        const uint32_t* src = &sprite->pixels[base];
+        for (int k = 0; k < count; k++)
+            m_row[k] = src[index[k]];
+        blendRow(&m_pixels[static_cast<size_t>(y) * m_width + x0], m_row.data(), count);
+    }
+}
+
+// Source over destination, (src * a + dst * (255 - a)) / 255 rounded, with
+// red and blue in one word and green in another. The framebuffer stays
+// opaque. Written as straight-line integer code over two arrays so the
+// compiler can vectorize it.
+void SoftwareRenderer::blendRow(uint32_t* dst, const uint32_t* src, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t s = src[i];
+        uint32_t d = dst[i];
+        uint32_t a = s >> 24;
+        uint32_t na = 255 - a;
+        uint32_t rb = (s & 0x00ff00ff) * a + (d & 0x00ff00ff) * na + 0x00800080;
+        uint32_t g = (s & 0x0000ff00) * a + (d & 0x0000ff00) * na + 0x00008000;
+        rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+        g = ((g + ((g >> 8) & 0x0000ff00)) >> 8) & 0x0000ff00;
+        dst[i] = rb | g | 0xff000000;
+    }
+}
+
+uint32_t SoftwareRenderer::placeholderColor(int imageID)
+{
+    uint32_t h = static_cast<uint32_t>(imageID + 1) * 2654435761u;
+    h ^= h >> 15;
+    return (h & 0x007f7f7f) + 0x00606060 + 0xff000000;
+}
+
+bool SoftwareRenderer::savePPM(const string& path) const
+{
+    ofstream out(path.c_str(), ios::out | ios::binary | ios::trunc);
+    out << "P6\n" << m_width << " " << m_height << "\n255\n";
+    vector<unsigned char> row(static_cast<size_t>(m_width) * 3);
+    for (int y = 0; y < m_height && out; y++)
+    {
+        const uint32_t* p = &m_pixels[static_cast<size_t>(y) * m_width];
+        for (int x = 0; x < m_width; x++)
+        {
+            row[3 * x] = p[x] & 0xff;
+            row[3 * x + 1] = (p[x] >> 8) & 0xff;
+            row[3 * x + 2] = (p[x] >> 16) & 0xff;
+        }
+        out.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return static_cast<bool>(out);
+}
+
+bool SoftwareRenderer::saveTGA(const string& path) const
+{
+    ofstream out(path.c_str(), ios::out | ios::binary | ios::trunc);
+    unsigned char header[18] = {0};
+    header[2] = 2;
+    header[12] = m_width & 0xff;
+    header[13] = (m_width >> 8) & 0xff;
+    header[14] = m_height & 0xff;
+    header[15] = (m_height >> 8) & 0xff;
+    header[16] = 32;
+    header[17] = 0x28;     // 8 alpha bits, rows from the top
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    vector<unsigned char> row(static_cast<size_t>(m_width) * 4);
+    for (int y = 0; y < m_height && out; y++)
+    {
+        const uint32_t* p = &m_pixels[static_cast<size_t>(y) * m_width];
+        for (int x = 0; x < m_width; x++)
+        {
+            row[4 * x] = (p[x] >> 16) & 0xff;
+            row[4 * x + 1] = (p[x] >> 8) & 0xff;
+            row[4 * x + 2] = p[x] & 0xff;
+            row[4 * x + 3] = (p[x] >> 24) & 0xff;
+        }
+        out.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return static_cast<bool>(out);
+}
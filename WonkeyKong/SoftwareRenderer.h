@@ -0,0 +1,89 @@
+#ifndef SOFTWARERENDERER_H_
+#define SOFTWARERENDERER_H_
+
+#include "GraphObject.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TileLayer;
+
+// SoftwareRenderer
+// Draws the board into an in-memory RGBA framebuffer with no GL, GLUT or
+// display, for frame capture on machines without a GPU. plotSprite() takes
+// the same arguments as SpriteManager's, except that the location is a board
+// cell rather than GL coordinates and the depth orders the sprites: flush()
+// draws the deepest first, then each depth in plotting order, alpha blending
+// every sprite over what is already there; the framebuffer stays opaque.
+// Each board cell is cellSize pixels square and a sprite of size s covers s
+// cells. Sprites are scaled nearest-neighbour and turned to the nearest
+// quarter, and a sprite facing 180 degrees is mirrored rather than turned
+// upside down, as on screen.
+//
+// Images without loaded frames are drawn as solid squares in a colour picked
+// from the image ID, so a capture is readable even without sprite files.
+//
+// Pixels are packed R | G << 8 | B << 16 | A << 24 and rows run from the top
+// of the board down.
+class SoftwareRenderer
+{
+public:
+    explicit SoftwareRenderer(int cellSize = 16);
+
+    bool loadSprite(const std::string& filenameTga, int imageID, int frame);
+    int numFrames(int imageID) const;
+    void setImageDepth(int imageID, int depth);
+
+    void clear(std::uint32_t color = 0xff000000);
+    void plotSprite(int imageID, int frame, double x, double y, int depth, int angleDegrees, double size);
+    void flush();
+
+    // Clears, then draws every visible graph object and tile at its
+    // image's depth; objects are drawn where they are headed, since nothing
+    // animates them without a display. The frame shows the VIEW_WIDTH x
+    // VIEW_HEIGHT cells whose bottom left corner is (viewX, viewY).
+    void renderFrame(const GraphObject::Registry& objects, const TileLayer* tiles, int viewX = 0, int viewY = 0);
+
+    int width() const {return m_width;}
+    int height() const {return m_height;}
+    const std::uint32_t* pixels() const {return m_pixels.data();}
+
+    bool savePPM(const std::string& path) const;
+    bool saveTGA(const std::string& path) const;
+
+private:
+    struct Sprite
+    {
+        int width;
+        int height;
+        std::vector<std::uint32_t> pixels;  // top row first
+    };
+
+    struct Plot
+    {
+        int depth;
+        int imageID;
+        int frame;
+        int left;       // pixel column of the left edge
+        int top;        // pixel row of the top edge
+        int side;       // pixels
+        int quarter;    // quarter turns anticlockwise
+    };
+
+    const Sprite* findSprite(int imageID, int frame) const;
+    void draw(const Plot& plot);
+    void blendRow(std::uint32_t* dst, const std::uint32_t* src, int count);
+    static std::uint32_t placeholderColor(int imageID);
+
+    int m_cellSize;
+    int m_width;
+    int m_height;
+    std::vector<std::uint32_t> m_pixels;
+    std::vector<std::vector<Sprite> > m_sprites;    // by image ID, then frame
+    std::vector<int> m_depths;                      // by image ID
+    std::vector<Plot> m_plots;                      // queued until flush()
+    std::vector<int> m_index;                       // scratch for the sampling tables
+    std::vector<std::uint32_t> m_row;               // one sampled row of a sprite
+};
+
+#endif // SOFTWARERENDERER_H_
@@ -16,28 +16,69 @@
 #define GL_BGRA GL_BGRA_EXT
 #endif
 
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
 #include "GameConstants.h"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <map>
+#include <vector>
 #include <memory>
 #include <algorithm>
 #include <cstring>
 #include <cmath>
 
+  // SpriteManager
+  // Sprites are decoded at load time and packed into atlas textures: every
+  // frame gets a power-of-two cell big enough for the largest sprite plus a
+  // one-texel border, so filtering never reaches a neighbouring frame.
+  // plotSprite() by handle only appends a quad to one shared vertex array;
+  // flush() submits everything plotted since the last flush with one state
+  // setup and one glDrawArrays call per run of quads on the same atlas page
+  // (in practice a single run). Call flush() once per frame after the last
+  // plotSprite(); nothing is drawn until then. Nothing here needs more than
+  // OpenGL 1.1, so it runs the same under a software renderer.
+  //
+  // Each loaded frame also has a handle, a small index that stays valid for
+  // the SpriteManager's lifetime, so callers that draw the same images every
+  // frame can resolve them once and skip the per-plot lookups. Callers that
+  // keep sprites in place from frame to frame can go further: makeQuad() does
+  // the placement math once, plotQuad() replays its result, and redraw()
+  // draws the last flushed frame again without touching the vertex data.
 class SpriteManager
 {
 public:
 
+	static const int INVALID_SPRITE_HANDLE = -1;
+
+	  // Laid out for glInterleavedArrays(GL_T2F_V3F)
+	struct Vertex
+	{
+		GLfloat u, v;
+		GLfloat x, y, z;
+	};
+
+	  // A sprite placed on screen, ready to plot; see makeQuad()
+	struct Quad
+	{
+		int page;
+		Vertex corners[4];
+	};
+
 	SpriteManager()
-	 : m_mipMapped(true)
+	 : m_atlasDirty(false), m_atlasRevision(0), m_submitted(false),
+	   m_cellSize(0), m_pageSize(0)
 	{
 	}
 
-	void setMipMapping(bool status)
+	  // Atlas pages are never mipmapped: each smaller level would average
+	  // sprites into their neighbours across the one-texel gutter. Kept so
+	  // callers written for one texture per sprite still build.
+	void setMipMapping(bool)
 	{
-		m_mipMapped = status;
 	}
 
 	bool loadSprite(std::string filename_tga, int imageID, int frameNum)
@@ -50,8 +91,6 @@ public:
 
 		m_frameCountPerSprite[imageID]++;  // keep track of how many frames per sprite we loaded
 
-		std::string line;
-		std::string contents = "";
 		std::ifstream tgaFile(filename_tga, std::ios::in|std::ios::binary);
 
 		if (!tgaFile) {
@@ -64,9 +103,6 @@ public:
 		unsigned char byteCount = static_cast<unsigned char>(header.pixel_depth) / 8;
 		const long imageSize = header.width_pixels * header.height_pixels * byteCount;
 
-		unsigned int textureWidth = header.width_pixels;
-		unsigned int textureHeight = header.height_pixels;
-
 		std::unique_ptr<char[]> imageData(new char[imageSize]);
 		tgaFile.seekg(18);
 		  // Read image data
@@ -96,53 +132,27 @@ public:
 		if (header.image_descriptor & 0x20)  // image ios flipped vertically
 	  		flipVertical(imageData.get(),header.width_pixels,header.height_pixels,byteCount);
 
-		// Transfer Texture To OpenGL
-
-		glEnable(GL_DEPTH_TEST);
-
-		  // allocate a texture handle
-		GLuint glTextureID;
-		glGenTextures(1, &glTextureID);
-
-		  // bind our new texture
-		glBindTexture(GL_TEXTURE_2D, glTextureID);
-
-		glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-
-		if (m_mipMapped)
+		  // Keep the pixels as RGBA until the atlas is built; BGR images are opaque
+		auto found = m_handles.find(spriteID);
+		if (found == m_handles.end())
 		{
-			  // when texture area is small, bilinear filter the closest mipmap
-			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			  // when texture area is large, bilinear filter the first mipmap
-			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			found = m_handles.insert(std::make_pair(spriteID, static_cast<int>(m_images.size()))).first;
+			m_images.push_back(Image());
 		}
-		else
+		Image& image = m_images[found->second];
+		image.width = header.width_pixels;
+		image.height = header.height_pixels;
+		image.pixels.resize(static_cast<size_t>(image.width) * image.height * 4);
+		const unsigned char* src = reinterpret_cast<const unsigned char*>(imageData.get());
+		for (size_t i = 0, n = static_cast<size_t>(image.width) * image.height; i < n; i++, src += byteCount)
 		{
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			image.pixels[4*i] = src[2];
+			image.pixels[4*i+1] = src[1];
+			image.pixels[4*i+2] = src[0];
+			image.pixels[4*i+3] = (byteCount == 4 ? src[3] : 255);
 		}
 
-		  // Have the texture wrap both vertically and horizontally.
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, static_cast<GLfloat>(GL_REPEAT));
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, static_cast<GLfloat>(GL_REPEAT));
-
-		if (m_mipMapped)
-		{
-			  // build our texture mipmaps
-			  // byteCount of 3 means that BGR data is being supplied. byteCount of 4 means that BGRA data is being supplied.
-			makeMipmaps(byteCount, textureWidth, textureHeight, imageData.get());
-		}
-		else
-		{
-			  // byteCount of 3 means that BGR data is being supplied. byteCount of 4 means that BGRA data is being supplied.
-			if (3 == byteCount)
-				glTexImage2D(GL_TEXTURE_2D, 0, 3, textureWidth, textureHeight, 0, GL_BGR, GL_UNSIGNED_BYTE, imageData.get());
-			else if (4 == byteCount)
-				glTexImage2D(GL_TEXTURE_2D, 0, 4, textureWidth, textureHeight, 0, GL_BGRA, GL_UNSIGNED_BYTE, imageData.get());
-		}
-
-		m_imageMap[spriteID] = glTextureID;
-
+		m_atlasDirty = true;
 		return true;
 	}
 
@@ -156,43 +166,70 @@ public:
 	}
 
 
-	bool plotSprite(int imageID, int frame, double gx, double gy, double gz, int angleDegrees, double size)
+	  // Handle for a loaded frame, or INVALID_SPRITE_HANDLE
+	int getSpriteHandle(int imageID, int frame) const
 	{
-		int spriteID = getSpriteID(imageID,frame);
-		if (INVALID_SPRITE_ID == spriteID)
-			return false;
+		auto it = m_handles.find(getSpriteID(imageID, frame));
+		if (it == m_handles.end())
+			return INVALID_SPRITE_HANDLE;
+
+		return it->second;
+	}
+
+	  // Changes whenever the atlas is rebuilt, which invalidates every Quad
+	unsigned int getAtlasRevision()
+	{
+		if (m_atlasDirty)
+			buildAtlas();
+
+		return m_atlasRevision;
+	}
+
+	  // Atlas page a frame is drawn from; plots are cheapest in page order
+	int getSpritePage(int handle)
+	{
+		if (m_atlasDirty)
+			buildAtlas();
+
+		if (handle < 0 || handle >= static_cast<int>(m_entries.size()))
+			return 0;
+
+		return m_entries[handle].page;
+	}
 
-		auto it = m_imageMap.find(spriteID);
-		if (it == m_imageMap.end())
+	  // Looks the frame's handle up on every call; prefer the handle overload
+	bool plotSprite(int imageID, int frame, double gx, double gy, double gz, int angleDegrees, double size)
+	{
+		int handle = getSpriteHandle(imageID, frame);
+		if (INVALID_SPRITE_HANDLE == handle)
 			return false;
 
-		double finalWidth, finalHeight;
+		return plotSprite(handle, gx, gy, gz, angleDegrees, size);
+	}
 
-		finalWidth = SPRITE_WIDTH_GL * size;
-		finalHeight = SPRITE_HEIGHT_GL * size;
+	bool plotSprite(int handle, double gx, double gy, double gz, int angleDegrees, double size)
+	{
+		Quad quad;
+		if (!makeQuad(handle, gx, gy, gz, angleDegrees, size, quad))
+			return false;
 
-		// object's x/y location is center-based, but sprite plotting is upper-left-corner based
-		const double xoffset = 0;// finalWidth / 2;
-		const double yoffset = 0;// finalHeight / 2;
+		plotQuad(quad);
+		return true;
+	}
 
-		glPushMatrix();
-		glTranslatef(static_cast<GLfloat>(gx-xoffset),static_cast<GLfloat>(gy-yoffset),static_cast<GLfloat>(gz));
-		glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glEnable(GL_TEXTURE_2D);
-		glDisable(GL_DEPTH_TEST);
-		glEnable (GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glBindTexture(GL_TEXTURE_2D, it->second);
+	bool makeQuad(int handle, double gx, double gy, double gz, int angleDegrees, double size, Quad& quad)
+	{
+		if (m_atlasDirty)
+			buildAtlas();
 
-		glColor3f(1.0, 1.0, 1.0);
+		if (handle < 0 || handle >= static_cast<int>(m_entries.size()))
+			return false;
+		const AtlasEntry& entry = m_entries[handle];
 
-		double cx1,cx2,cx3,cx4;
-		double cy1,cy2,cy3,cy4;
+		double finalWidth, finalHeight;
 
-		cx1 = cy1 = 0;
-		cx2 = 1; cy2 = 0;
-		cx3 = 1; cy3 = 1;
-		cx4 = 0; cy4 = 1;
+		finalWidth = SPRITE_WIDTH_GL * size;
+		finalHeight = SPRITE_HEIGHT_GL * size;
 
 		double rx1, ry1, rx2, ry2, rx3, ry3, rx4, ry4;
 
@@ -224,48 +261,82 @@ public:
 		rotate(-finalWidth / 2, finalHeight / 2, angleDegrees, rx4, ry4);
 #endif  // FULL_ROTATION
 
-		glBegin(GL_QUADS);
-		glTexCoord2d(cx1, cy1);
-		glVertex3f(static_cast<GLfloat>(rx1), static_cast<GLfloat>(ry1), 0);
-		glTexCoord2d(cx2, cy2);
-		glVertex3f(static_cast<GLfloat>(rx2), static_cast<GLfloat>(ry2), 0);
-		glTexCoord2d(cx3, cy3);
-		glVertex3f(static_cast<GLfloat>(rx3), static_cast<GLfloat>(ry3), 0);
-		glTexCoord2d(cx4, cy4);
-		glVertex3f(static_cast<GLfloat>(rx4), static_cast<GLfloat>(ry4), 0);
-		glEnd();
-
-
-		/*
-		glBegin (GL_QUADS);
-		  glTexCoord2d(cx1, cy1);
-		  glVertex3f(0, 0, 0);
-		  glTexCoord2d(cx2, cy2);
-		  glVertex3f(static_cast<GLfloat>(finalWidth), 0, 0);
-		  glTexCoord2d(cx3, cy3);
-		  glVertex3f(static_cast<GLfloat>(finalWidth), static_cast<GLfloat>(finalHeight), 0);
-		  glTexCoord2d(cx4, cy4);
-		  glVertex3f(0, static_cast<GLfloat>(finalHeight), 0);
-		glEnd();
-		*/
-
-		glDisable(GL_TEXTURE_2D);
-		glEnable(GL_DEPTH_TEST);
-
-		glPopAttrib();
-		glPopMatrix();
+		quad.page = entry.page;
+		quad.corners[0] = makeVertex(entry.u0, entry.v0, gx + rx1, gy + ry1, gz);
+		quad.corners[1] = makeVertex(entry.u1, entry.v0, gx + rx2, gy + ry2, gz);
+		quad.corners[2] = makeVertex(entry.u1, entry.v1, gx + rx3, gy + ry3, gz);
+		quad.corners[3] = makeVertex(entry.u0, entry.v1, gx + rx4, gy + ry4, gz);
 
 		return true;
 	}
 
+	  // Quads must come from makeQuad() since the last atlas change
+	void plotQuad(const Quad& quad)
+	{
+		if (m_submitted)
+		{
+			  // Both keep their capacity for the next frame
+			m_quads.clear();
+			m_batches.clear();
+			m_submitted = false;
+		}
+
+		if (m_batches.empty() || m_batches.back().page != quad.page)
+		{
+			Batch batch = { quad.page, static_cast<GLint>(m_quads.size()), 0 };
+			m_batches.push_back(batch);
+		}
+		m_batches.back().count += 4;
+
+		m_quads.insert(m_quads.end(), quad.corners, quad.corners + 4);
+	}
+
+	  // Draws every sprite plotted since the last flush, in plotting order
+	void flush()
+	{
+		if (m_submitted || m_quads.empty())
+			return;
+
+		drawQuads();
+		m_submitted = true;
+	}
+
+	  // Draws the last flushed sprites again
+	void redraw()
+	{
+		if (m_submitted)
+			drawQuads();
+	}
+
 	~SpriteManager()
 	{
-		for (auto it = m_imageMap.begin(); it != m_imageMap.end(); it++)
-			glDeleteTextures(1, &it->second);
+		releasePages();
 	}
 
 private:
 
+	void drawQuads()
+	{
+		glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT | GL_TEXTURE_BIT);
+		glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+		glEnable(GL_TEXTURE_2D);
+		glDisable(GL_DEPTH_TEST);
+		glEnable (GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+		glColor3f(1.0, 1.0, 1.0);
+
+		glInterleavedArrays(GL_T2F_V3F, 0, m_quads.data());
+		for (const Batch& batch : m_batches)
+		{
+			glBindTexture(GL_TEXTURE_2D, m_pages[batch.page]);
+			glDrawArrays(GL_QUADS, batch.first, batch.count);
+		}
+
+		glPopClientAttrib();
+		glPopAttrib();
+	}
+
 #pragma pack(1)
   struct TGA_HEADER {
 	unsigned char id_length;
@@ -283,14 +354,139 @@ private:
   };
 #pragma pack()
 
-	bool                  m_mipMapped;
-	std::map<int, GLuint> m_imageMap;
-	std::map<int, int>    m_frameCountPerSprite;
+	struct Image
+	{
+		int width;
+		int height;
+		std::vector<unsigned char> pixels;  // RGBA, bottom row first
+	};
+
+	struct AtlasEntry
+	{
+		int page;
+		GLfloat u0, v0, u1, v1;
+	};
+
+	  // Consecutive quads drawn from the same page
+	struct Batch
+	{
+		int page;
+		GLint first;
+		GLsizei count;
+	};
+
+	bool                      m_atlasDirty;
+	unsigned int              m_atlasRevision;
+	bool                      m_submitted;  // m_quads has been drawn; the next plot starts afresh
+	std::map<int, int>        m_handles;   // sprite ID to handle
+	std::vector<Image>        m_images;    // by handle
+	std::vector<AtlasEntry>   m_entries;   // by handle
+	std::vector<GLuint>       m_pages;
+	std::vector<Vertex>       m_quads;
+	std::vector<Batch>        m_batches;
+	std::map<int, int>        m_frameCountPerSprite;
+	int                       m_cellSize;
+	int                       m_pageSize;
 
 	static const int INVALID_SPRITE_ID = -1;
 	static const int MAX_IMAGES = 1000;
 	static const int MAX_FRAMES_PER_SPRITE = 100;
 
+	static Vertex makeVertex(GLfloat u, GLfloat v, double x, double y, double z)
+	{
+		Vertex vertex = { u, v, static_cast<GLfloat>(x), static_cast<GLfloat>(y), static_cast<GLfloat>(z) };
+		return vertex;
+	}
+
+	void buildAtlas()
+	{
+		flush();  // pending quads refer to the old pages
+		m_quads.clear();
+		m_batches.clear();
+		m_submitted = false;
+		m_atlasDirty = false;
+		m_atlasRevision++;
+		releasePages();
+		m_entries.assign(m_images.size(), AtlasEntry());
+		if (m_images.empty())
+			return;
+
+		  // One texel of gutter round each sprite repeats its edge, as clamping would
+		int largest = 1;
+		for (const Image& image : m_images)
+			largest = std::max(largest, std::max(image.width, image.height));
+		m_cellSize = 1;
+		while (m_cellSize < largest + 2)
+			m_cellSize *= 2;
+
+		  // Square pages no larger than the GL allows, holding as few cells as will do
+		GLint maxSize = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+		maxSize = std::max(maxSize, m_cellSize);
+		int cellsPerRow = 1;
+		while (cellsPerRow * cellsPerRow < static_cast<int>(m_images.size()) && cellsPerRow * 2 * m_cellSize <= maxSize)
+			cellsPerRow *= 2;
+		m_pageSize = cellsPerRow * m_cellSize;
+		const int cellsPerPage = cellsPerRow * cellsPerRow;
+
+		std::vector<unsigned char> pixels;
+		size_t handle = 0;
+		for (int page = 0; handle < m_images.size(); page++)
+		{
+			pixels.assign(static_cast<size_t>(m_pageSize) * m_pageSize * 4, 0);
+			for (int cell = 0; cell < cellsPerPage && handle < m_images.size(); cell++, handle++)
+			{
+				const Image& img = m_images[handle];
+				int cx = (cell % cellsPerRow) * m_cellSize + 1;
+				int cy = (cell / cellsPerRow) * m_cellSize + 1;
+				for (int row = -1; row <= img.height; row++)
+				{
+					int srcRow = std::min(std::max(row, 0), img.height - 1);
+					const unsigned char* src = &img.pixels[static_cast<size_t>(srcRow) * img.width * 4];
+					unsigned char* dst = &pixels[(static_cast<size_t>(cy + row) * m_pageSize + cx) * 4];
+					std::memcpy(dst, src, static_cast<size_t>(img.width) * 4);
+					std::memcpy(dst - 4, src, 4);
+					std::memcpy(dst + img.width * 4, src + (img.width - 1) * 4, 4);
+				}
+
+				AtlasEntry& entry = m_entries[handle];
+				entry.page = page;
+				entry.u0 = static_cast<GLfloat>(cx) / m_pageSize;
+				entry.v0 = static_cast<GLfloat>(cy) / m_pageSize;
+				entry.u1 = static_cast<GLfloat>(cx + img.width) / m_pageSize;
+				entry.v1 = static_cast<GLfloat>(cy + img.height) / m_pageSize;
+			}
+
+			m_pages.push_back(uploadPage(pixels.data()));
+		}
+	}
+
+	GLuint uploadPage(const unsigned char* pixels) const
+	{
+		GLuint glTextureID;
+		glGenTextures(1, &glTextureID);
+		glBindTexture(GL_TEXTURE_2D, glTextureID);
+
+		  // No mipmaps, so minified sprites sample only their own cell and gutter
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		  // Sprites share the page, so nothing may wrap round to the far edge
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_pageSize, m_pageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+		return glTextureID;
+	}
+
+	void releasePages()
+	{
+		if (!m_pages.empty())
+			glDeleteTextures(static_cast<GLsizei>(m_pages.size()), m_pages.data());
+		m_pages.clear();
+	}
+
 	void rotate(double x, double y, double degrees, double &xout, double &yout)
 	{
 		double theta = degrees*1.0 / 360 * 2 * 3.14159;
@@ -315,17 +511,9 @@ private:
 		return imageID * MAX_FRAMES_PER_SPRITE + frame;
 	}
 
-	static void makeMipmaps(unsigned char byteCount, unsigned int textureWidth, unsigned int textureHeight, char* imageData)
-	{
-		int format = (byteCount == 3 ? GL_BGR : GL_BGRA);
-#ifdef __APPLE__
-		int internalFormat = (byteCount == 3 ? GL_RGB : GL_RGBA);
-		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, textureWidth, textureHeight, 0, format, GL_UNSIGNED_BYTE, imageData);
-		glGenerateMipmap(GL_TEXTURE_2D);
-#else
-		gluBuild2DMipmaps(GL_TEXTURE_2D, byteCount, textureWidth, textureHeight, format, GL_UNSIGNED_BYTE, imageData);
-#endif
-	}
+	  // Prevent copying or assigning SpriteManagers
+	SpriteManager(const SpriteManager&);
+	SpriteManager& operator=(const SpriteManager&);
 };
 
 #if defined(__APPLE__)
@@ -1,73 +1,115 @@
 #include "StudentWorld.h"
 #include "GameConstants.h"
+#include "LevelGenerator.h"
 #include <string>
-#include <sstream>
-#include <iomanip>
+#include <algorithm>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+#include <iostream>
 using namespace std;
 
 GameWorld* createStudentWorld(string assetPath)
 {
-    return new StudentWorld(assetPath);
+    random_device rd;
+    StudentWorld* world = new StudentWorld(assetPath, (static_cast<uint64_t>(rd()) << 32) | rd());
+    
+    // Setting WONKYKONG_MAP to a size such as 200x200 plays generated levels
+    // of that size, and WONKYKONG_RECORD to a file name saves the session as
+    // a replay
+    const char* mapSize = getenv("WONKYKONG_MAP");
+    int width, height;
+    if (mapSize != nullptr)
+    {
+        if (parseMapSize(mapSize, width, height))
+            world->useGeneratedLevels(width, height);
+        else
+            cerr << "Ignoring WONKYKONG_MAP=" << mapSize << "; expected a size such as 200x200" << endl;
+    }
+    const char* recordPath = getenv("WONKYKONG_RECORD");
+    if (recordPath != nullptr && !world->startRecording(recordPath))
+        cerr << "Cannot record a replay to " << recordPath << endl;
+    
+    return world;
 }
 
-StudentWorld::StudentWorld(string assetPath)
-: GameWorld(assetPath), m_player(nullptr) {}
+StudentWorld::StudentWorld(string assetPath, uint64_t seed, GraphObject::Registry& graphObjects)
+: GameWorld(assetPath), m_graphObjects(&graphObjects), m_prefetcher(assetPath, m_levels),
+  m_levelNumber(-1), m_player(nullptr), m_input(nullptr),
+  m_seed(seed), m_mapWidth(0), m_mapHeight(0), m_rng(seed), m_tick(0), m_nextSerial(0), m_win(false), m_hudValid(false)
+{
+    // A compiled level catalog, when the assets have one, replaces the text files
+    m_levels.open(assetPath.empty() ? LEVEL_CATALOG_NAME : assetPath + "/" + LEVEL_CATALOG_NAME);
+}
 
 StudentWorld::~StudentWorld() {cleanUp();}
 
 int StudentWorld::init()
 {
-    ostringstream currLevName;
-    currLevName.fill('0');
-    currLevName <<"level" << setw(2) << getLevel() << ".txt";
+    // The level is kept across lives, so only a new level number loads anything,
+    // and that one has normally been staged in the background already
+    if (m_level == nullptr || m_levelNumber != getLevel())
+    {
+        Level::LoadResult result = Level::load_fail_file_not_found;
+        m_level.reset();
+        if (getLevel() <= MAX_LEVELS)
+            m_level = m_prefetcher.take(getLevel(), result);
+        if (result == Level::load_fail_file_not_found) return GWSTATUS_PLAYER_WON;
+        else if (result == Level::load_fail_bad_format) return GWSTATUS_LEVEL_ERROR;
+        
+        m_levelNumber = getLevel();
+        if (getLevel() < MAX_LEVELS)
+            m_prefetcher.prefetch(getLevel() + 1);
+    }
+    const Level& lev = *m_level;
     
-    Level lev(assetPath());
-    Level::LoadResult result = lev.loadLevel(currLevName.str());
-    if (getLevel() > MAX_LEVELS || result == Level::load_fail_file_not_found) return GWSTATUS_PLAYER_WON;
-    else if (result == Level::load_fail_bad_format) return GWSTATUS_LEVEL_ERROR;
+    m_tiles.build(lev);
+    m_chunks.reset(lev.width(), lev.height(), ChunkGrid::defaultConfig());
+    m_contactCells.reset(lev.width(), lev.height());
+    m_timers.clear(m_tick);
     
-    for (int x = 0; x < VIEW_WIDTH; x++)
+    for (int x = 0; x < lev.width(); x++)
     {
-        for (int y = 0; y < VIEW_HEIGHT; y++)
+        for (int y = 0; y < lev.height(); y++)
         {
             switch (lev.getContentsOf(x, y))
             {
                 case Level::empty :
                     break;
                 case Level::player :
-                    m_player = new Player(x, y, this);
+                    m_player = m_playerPool.create(x, y, this);
                     break;
                 case Level::left_kong :
-                    m_actors.push_back(new Kong(x, y, this, 180));
+                    track(m_kongs.spawn(x, y, this, 180));
                     break;
                 case Level::right_kong :
-                    m_actors.push_back(new Kong(x, y, this, 0));
+                    track(m_kongs.spawn(x, y, this, 0));
                     break;
                 case Level::floor :
-                    m_actors.push_back(new Floor(x, y, this));
-                    break;
                 case Level::ladder :
-                    m_actors.push_back(new Ladder(x, y, this));
                     break;
                 case Level::bonfire :
-                    m_actors.push_back(new Bonfire(x, y, this));
+                    track(m_bonfires.spawn(x, y, this));
                     break;
                 case Level::fireball :
-                    m_actors.push_back(new Fireball(x, y, this));
+                    track(m_fireballs.spawn(x, y, this));
                     break;
                 case Level::koopa :
-                    m_actors.push_back(new Koopa(x, y, this));
+                    track(m_koopas.spawn(x, y, this));
                     break;
                 case Level::extra_life :
-                    m_actors.push_back(new ExtraLifeGoodie(x, y, this));
+                    track(m_extraLifeGoodies.spawn(x, y, this));
                     break;
                 case Level::garlic :
-                    m_actors.push_back(new GarlicGoodie(x, y, this));
+                    track(m_garlicGoodies.spawn(x, y, this));
                     break;
             }
         }
     }
     
+    m_chunks.focus(m_player->getX(), m_player->getY());
+    wakeAt(m_player->getX(), m_player->getY());
     return GWSTATUS_CONTINUE_GAME;
 }
 
@@ -75,12 +117,14 @@ int StudentWorld::move()
 {
     // This code is here merely to allow the game to build, run, and terminate after you type q
     updateDisplayText();
+    m_tick++;
+    m_timers.advance(m_tick, [](Actor* ap) {ap->setWaiting(false);});
     
     m_player->doSomething();
-    for (Actor* actor : m_actors)
-    {
-        actor->doSomething();
-    }
+    resolveContacts();
+    forEachGroup([this](auto& group) {group.beginTick(m_tick);});
+    runTurns();
+    forEachGroup([](auto& group) {group.endTick();});
     
     if (clearDead())
     {
@@ -100,27 +144,31 @@ int StudentWorld::move()
 
 void StudentWorld::cleanUp()
 {
-    delete m_player;
+    if (m_player != nullptr) m_playerPool.release(m_player);
     m_player = nullptr;
     
-    while (!m_actors.empty())
-    {
-        delete m_actors.back();
-        m_actors.pop_back();
-    }
+    m_timers.clear(m_tick);
+    forEachGroup([](auto& group) {group.clear();});
+    
+    m_chunks.clear();
+    m_contactCells.clear();
+    m_tiles.clear();
+    
+    if (m_recorder) m_recorder->flush();
+}
+
+// The window follows the player, stopping at the edges of the board
+void StudentWorld::getViewOrigin(int& x, int& y) const
+{
+    x = y = 0;
+    if (m_player == nullptr) return;
+    x = max(0, min(m_player->getX() - VIEW_WIDTH / 2, boardWidth() - VIEW_WIDTH));
+    y = max(0, min(m_player->getY() - VIEW_HEIGHT / 2, boardHeight() - VIEW_HEIGHT));
 }
 
 bool StudentWorld::isBlocked(int x, int y) const
 {
-    for (Actor* actor : m_actors)
-    {
-        if (isAt(actor, x, y))
-        {
-            if (actor->isObstacle()) return true;
-        }
-    }
-    
-    return false;
+    return m_tiles.isBlocked(x, y);
 }
 
 bool StudentWorld::isAt(Actor* ap, int x, int y) const
@@ -132,112 +180,395 @@ bool StudentWorld::isAt(Actor* ap, int x, int y) const
 void StudentWorld::burnAt(int x, int y)
 {
     if (isAt(m_player, x, y)) m_player->setDead();
-    for (Actor* actor : m_actors)
+    
+    m_chunks.forEachAt(x, y, [](Actor* actor)
     {
-        if (isAt(actor, x, y))
+        if (actor->hasTrait(TRAIT_FLAMMABLE))
         {
-            if (!actor->fireProof())
-            {
-                actor->setDead();
-            }
+            actor->setDead();
         }
-    }
+    });
 }
 
 void StudentWorld::attackAt(int x, int y)
 {
-    for (Actor* actor : m_actors)
+    // Dropped goodies land in this same cell, so only the enemies that were
+    // here to begin with are visited. Each one rolls for a drop, so they go
+    // in the order they were created rather than the order they arrived.
+    m_targets.clear();
+    m_chunks.forEachAt(x, y, [this](Actor* actor)
+    {
+        if (actor->hasTrait(TRAIT_ENEMY)) m_targets.push_back(actor);
+    });
+    if (m_targets.size() > 1)
+        sort(m_targets.begin(), m_targets.end(), [](const Actor* a, const Actor* b) {return a->serial() < b->serial();});
+    
+    for (Actor* actor : m_targets)
     {
-        if (isAt(actor, x, y))
+        actor->setDead();
+        
+        int r = randInt(1,3);
+        if (r == 1)
         {
-            if (actor->isEnemy())
-            {
-                actor->setDead();
-                
-                int r = randInt(1,3), id = actor->dropGoodie();
-                if (r == 1)
-                {
-                    switch (id)
-                    {
-                        case -1:
-                            break;
-                        case 1:
-                            m_actors.push_back(new ExtraLifeGoodie(actor->getX(), actor->getY(), this));
-                            break;
-                        case 2:
-                            m_actors.push_back(new GarlicGoodie(actor->getX(), actor->getY(), this));
-                            break;
-                    }
-                }
-            }
+            if (actor->hasTrait(TRAIT_DROPS_EXTRA_LIFE))
+                track(m_extraLifeGoodies.spawn(actor->getX(), actor->getY(), this));
+            else if (actor->hasTrait(TRAIT_DROPS_GARLIC))
+                track(m_garlicGoodies.spawn(actor->getX(), actor->getY(), this));
         }
     }
 }
 
 bool StudentWorld::freeFall(int x, int y) const
 {
-    if (isBlocked(x, y - 1) || canClimb(x, y) || canClimb(x, y - 1)) return false;
-    return true;
+    return !m_tiles.isSupported(x, y);
 }
 
 bool StudentWorld::canClimb(int x, int y) const
 {
-    for (Actor* actor: m_actors)
+    return m_tiles.canClimb(x, y);
+}
+
+bool StudentWorld::isWalkable(int x, int y) const
+{
+    return m_tiles.isWalkable(x, y);
+}
+
+void StudentWorld::addBarrel(int x, int y, int direction)
+{
+    track(m_barrels.spawn(x, y, this, direction));
+}
+
+void StudentWorld::addBurp(int x, int y, int direction)
+{
+    track(m_burps.spawn(x, y, this, direction));
+}
+
+bool StudentWorld::readKey(int& value)
+{
+    bool gotKey = (m_input != nullptr ? m_input->getKey(m_tick, value) : getKey(value));
+    if (gotKey && m_recorder) m_recorder->record(m_tick, value);
+    return gotKey;
+}
+
+void StudentWorld::useGeneratedLevels(int width, int height)
+{
+    m_mapWidth = width;
+    m_mapHeight = height;
+    m_prefetcher.setGenerated(width, height, m_seed);
+}
+
+bool StudentWorld::startRecording(const string& path)
+{
+    m_recorder.reset(new ReplayRecorder(path, m_seed, getLevel(), m_mapWidth, m_mapHeight));
+    if (m_recorder->isOpen()) return true;
+    m_recorder.reset();
+    return false;
+}
+
+void StudentWorld::relocate(Actor* ap, int fromX, int fromY)
+{
+    markCell(ap->getX(), ap->getY());
+    if (ap == m_player)
     {
-        if (isAt(actor, x, y))
+        m_chunks.focus(ap->getX(), ap->getY());
+        wakeAt(ap->getX(), ap->getY());
+        return;
+    }
+    m_chunks.move(ap, fromX, fromY);
+}
+
+// Parks an actor until the given tick. Actors put off their next doSomething()
+// only while it would do nothing, so if the player steps into their cell in
+// the meantime, wakeAt() runs them early. Bonfires and burps never sleep,
+// so they still hit sleeping actors that are in their cells.
+void StudentWorld::sleepUntil(Actor* ap, long long tick)
+{
+    if (tick <= m_tick + 1) return;  // it would run on the next tick anyway
+    m_timers.schedule(ap, tick);
+    ap->setWaiting(true);
+}
+
+void StudentWorld::saveSnapshot(WorldSnapshot& snapshot) const
+{
+    snapshot.level = getLevel();
+    snapshot.score = getScore();
+    snapshot.lives = getLives();
+    snapshot.tick = m_tick;
+    m_rng.getState(snapshot.rngState, snapshot.rngInc);
+    snapshot.win = m_win;
+    snapshot.nextSerial = m_nextSerial;
+    if (m_player != nullptr) m_player->saveState(snapshot.player);
+    
+    snapshot.actors.clear();
+    snapshot.groupSizes.clear();
+    m_snapshotIndex.clear();
+    forEachGroup([&](const auto& group)
+    {
+        snapshot.groupSizes.push_back(group.actors().size());
+        // Saved through each actor's static type so every class records its own counters
+        for (const auto* ap : group.actors())
         {
-            if (actor->canClimb()) return true;
+            m_snapshotIndex.push_back(make_pair(static_cast<const Actor*>(ap), static_cast<int>(snapshot.actors.size())));
+            snapshot.actors.push_back(ActorState());
+            ap->saveState(snapshot.actors.back());
+        }
+    });
+    
+    // Each chunk's list is kept too, so restoring refills the chunks without
+    // sorting every actor into one
+    sort(m_snapshotIndex.begin(), m_snapshotIndex.end());
+    snapshot.occupancy.clear();
+    for (int chunk = 0; chunk < m_chunks.numChunks(); chunk++)
+    {
+        snapshot.occupancy.push_back(static_cast<int>(m_chunks.actorsIn(chunk).size()));
+        for (const Actor* ap : m_chunks.actorsIn(chunk))
+        {
+            vector<pair<const Actor*, int> >::const_iterator it =
+                lower_bound(m_snapshotIndex.begin(), m_snapshotIndex.end(), make_pair(ap, -1));
+            snapshot.occupancy.push_back(it->second);
         }
     }
-    return false;
 }
 
-void StudentWorld::addBarrel(int x, int y, int direction)
+bool StudentWorld::restoreSnapshot(const WorldSnapshot& snapshot)
 {
-    m_actors.push_back(new Barrel(x, y, this, direction));
+    if (m_player == nullptr || snapshot.level != getLevel() || !isConsistent(snapshot)) return false;
+    
+    increaseScore(snapshot.score - getScore());
+    while (getLives() < snapshot.lives) incLives();
+    while (getLives() > snapshot.lives) decLives();
+    m_tick = snapshot.tick;
+    m_win = snapshot.win;
+    m_nextSerial = snapshot.nextSerial;
+    m_player->loadState(snapshot.player);
+    
+    // Reuse the actors already in each group and only spawn or release the difference
+    m_timers.clear(m_tick);
+    size_t group = 0, next = 0;
+    m_restored.clear();
+    forEachGroup([&](auto& g)
+    {
+        typedef typename decay<decltype(g)>::type::ActorType T;
+        size_t n = snapshot.groupSizes[group++];
+        g.truncate(n);
+        while (g.actors().size() < n)
+        {
+            if constexpr (is_constructible<T, int, int, StudentWorld*, int>::value) g.spawn(0, 0, this, 0);
+            else g.spawn(0, 0, this);
+        }
+        for (T* ap : g.actors())
+        {
+            ap->loadState(snapshot.actors[next++]);
+            m_restored.push_back(ap);
+        }
+    });
+    
+    m_chunks.clear();
+    const int* list = snapshot.occupancy.data();
+    for (int chunk = 0; chunk < m_chunks.numChunks(); chunk++)
+    {
+        for (int n = *list++; n > 0; n--)
+            m_chunks.add(m_restored[*list++]);
+    }
+    
+    rebuildSchedule();
+    
+    // Last, since constructing enemies above draws from the RNG
+    m_rng.setState(snapshot.rngState, snapshot.rngInc);
+    return true;
 }
 
-void StudentWorld::addBurp(int x, int y, int direction)
+// Private & Nonmember functions
+
+// Whether a snapshot's parts agree with each other and with this world's
+// groups, so restoring it cannot index past any of them
+bool StudentWorld::isConsistent(const WorldSnapshot& snapshot) const
 {
-    m_actors.push_back(new Burp(x, y, this, direction));
+    size_t groups = 0;
+    forEachGroup([&](const auto&) {groups++;});
+    if (snapshot.groupSizes.size() != groups) return false;
+    
+    size_t actors = 0;
+    for (size_t n : snapshot.groupSizes)
+    {
+        if (n > snapshot.actors.size() - actors) return false;
+        actors += n;
+    }
+    if (actors != snapshot.actors.size()) return false;
+    
+    // A count for every chunk, each followed by the indices of that many
+    // actors standing in it
+    size_t next = 0;
+    for (int chunk = 0; chunk < m_chunks.numChunks(); chunk++)
+    {
+        if (next >= snapshot.occupancy.size()) return false;
+        int n = snapshot.occupancy[next++];
+        if (n < 0 || static_cast<size_t>(n) > snapshot.occupancy.size() - next) return false;
+        for (; n > 0; n--)
+        {
+            int index = snapshot.occupancy[next++];
+            if (index < 0 || static_cast<size_t>(index) >= actors) return false;
+            const ActorState& state = snapshot.actors[index];
+            if (m_chunks.chunkAt(state.x, state.y) != chunk) return false;
+        }
+    }
+    return next == snapshot.occupancy.size();
 }
 
-// Private & Nonmember functions
+bool StudentWorld::inBounds(int x, int y) const
+{
+    return x >= 0 && x < boardWidth() && y >= 0 && y < boardHeight();
+}
 
-bool StudentWorld::clearDead()
+void StudentWorld::track(Actor* ap)
+{
+    ap->setSerial(m_nextSerial++);
+    m_chunks.add(ap);
+    markCell(ap->getX(), ap->getY());
+}
+
+void StudentWorld::untrack(Actor* ap, int x, int y)
 {
-    vector<Actor*>::iterator it;
-    it = m_actors.begin();
-    while (it != m_actors.end())
+    m_chunks.remove(ap, x, y);
+}
+
+// Recomputes which actors think when after they have been rewritten
+// wholesale. Waiting actors are not saved, so every actor runs on the next
+// tick and schedules itself again.
+void StudentWorld::rebuildSchedule()
+{
+    m_timers.clear(m_tick);
+    forEachGroup([this](auto& group)
+    {
+        for (Actor* ap : group.actors())
+        {
+            ap->setDormant(ap->hasTrait(TRAIT_DORMANT));
+            ap->setWaiting(false);
+            
+            // Arrivals waiting for the next contact pass are not saved, so
+            // every occupied cell is looked at again
+            markCell(ap->getX(), ap->getY());
+        }
+    });
+    markCell(m_player->getX(), m_player->getY());
+    m_chunks.refocus(m_player->getX(), m_player->getY());
+    wakeAt(m_player->getX(), m_player->getY());
+    forEachGroup([](auto& group) {group.resetAwake();});
+}
+
+// Gives every actor due this tick its turn in creation order, the order of
+// the single actor list the groups replaced. The group holding the oldest
+// due actor runs until another group's next actor is older; nothing joins
+// a group's pass once it has begun, so that bound holds for the whole run.
+void StudentWorld::runTurns()
+{
+    for (;;)
+    {
+        unsigned int first = NO_TURN, second = NO_TURN;
+        int index = 0, chosen = -1;
+        forEachGroup([&](auto& group)
+        {
+            unsigned int turn = group.nextTurn();
+            if (turn < first)
+            {
+                second = first;
+                first = turn;
+                chosen = index;
+            }
+            else if (turn < second) second = turn;
+            index++;
+        });
+        if (chosen < 0) return;
+        
+        index = 0;
+        forEachGroup([&](auto& group)
+        {
+            if (index++ == chosen) group.tickUntil(second);
+        });
+    }
+}
+
+// Enemies look for the player in their own turns, so one waiting in the
+// player's cell has to take this tick's turn
+void StudentWorld::wakeAt(int x, int y)
+{
+    m_chunks.forEachAt(x, y, [this](Actor* ap)
     {
-        if ((*it)->isDead())
+        if (ap->isWaiting())
         {
-            delete (*it);
-            it = m_actors.erase(it);
-            continue;
+            m_timers.cancel(ap);
+            ap->setWaiting(false);
         }
-        it++;
+    });
+}
+
+void StudentWorld::markCell(int x, int y)
+{
+    if (!inBounds(x, y)) return;
+    m_contactCells.mark(x, y);
+}
+
+// Pickups
+// A goodie and the player can only start sharing a cell when one of them
+// arrives in it, so each pass visits just the cells something moved into or
+// spawned in since the last one. It runs after the player has moved and
+// ahead of every other actor, where goodies used to take their turns; a
+// goodie dropped this tick waits for the next pass. Bonfires, burps and
+// enemies still act on their own turns, in creation order, since who
+// moves first decides who gets hit.
+void StudentWorld::resolveContacts()
+{
+    for (const pair<int, int>& c : m_contactCells.cells())
+    {
+        int x = c.first, y = c.second;
+        if (!isAt(m_player, x, y)) continue;
+        
+        m_chunks.forEachAt(x, y, [](Actor* ap)
+        {
+            if (!ap->isDead()) ap->contactPlayer();
+        });
     }
+    m_contactCells.clear();
+}
+
+bool StudentWorld::clearDead()
+{
+    forEachGroup([this](auto& group)
+    {
+        group.sweep([this](Actor* ap)
+        {
+            m_timers.cancel(ap);
+            untrack(ap, ap->getX(), ap->getY());
+        });
+    });
+    
     if (m_player->isDead()) return true;
     else return false;
 }
 
+// The stat line is only rebuilt, and only handed to the controller, when one
+// of its numbers has changed since the last tick
 void StudentWorld::updateDisplayText() 
 {
     int score = getScore();
     int level = getLevel();
     int livesLeft = getLives();
-    unsigned int burps = m_player->getBurps();
+    int burps = m_player->getBurps();
+    
+    if (m_hudValid && score == m_hudScore && level == m_hudLevel && livesLeft == m_hudLives && burps == m_hudBurps)
+        return;
     
-    string s = generate_stats(score, level, livesLeft, burps);
+    m_hudValid = true;
+    m_hudScore = score;
+    m_hudLevel = level;
+    m_hudLives = livesLeft;
+    m_hudBurps = burps;
+    generate_stats(m_hudText, sizeof(m_hudText), score, level, livesLeft, burps);
     
-    setGameStatText(s);
+    setGameStatText(m_hudText);
 }
 
-string generate_stats(int score, int level, int livesLeft, int burps)
+void generate_stats(char* buffer, size_t size, int score, int level, int livesLeft, int burps)
 {
-    ostringstream oss;
-    oss.fill('0');
-    oss << "Score: " << setw(7) << score << " Level: " << setw(2) << level << " Lives: " << setw(2) << livesLeft << " Burps: " << setw(2) << burps << endl;
-    return oss.str();
+    snprintf(buffer, size, "Score: %07d Level: %02d Lives: %02d Burps: %02d\n", score, level, livesLeft, burps);
 }
@@ -3,18 +3,100 @@
 
 #include "GameWorld.h"
 #include "Level.h"
+#include "LevelCatalog.h"
+#include "LevelPrefetcher.h"
 #include "Actor.h"
+#include "TileLayer.h"
+#include "ChunkGrid.h"
+#include "TimerWheel.h"
+#include "ActorPool.h"
+#include "InputSource.h"
+#include "Rng.h"
+#include "Replay.h"
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+// WorldSnapshot
+// A complete copy of a level in progress: score, lives, tick and RNG state,
+// plus every actor's position, direction and counters. Filled by
+// StudentWorld::saveSnapshot() and applied by restoreSnapshot(); reusing one
+// snapshot object keeps both directions free of heap allocation once its
+// vectors have grown. restoreSnapshot() leaves the world alone and returns
+// false for a snapshot of another level or one whose parts do not agree.
+struct WorldSnapshot
+{
+    int level;
+    int score;
+    int lives;
+    long long tick;
+    std::uint64_t rngState;
+    std::uint64_t rngInc;
+    bool win;
+    unsigned int nextSerial;
+    ActorState player;
+    std::vector<ActorState> actors;         // every group, in forEachGroup() order
+    std::vector<std::size_t> groupSizes;
+    std::vector<int> occupancy;             // per chunk: count, then indices into actors
+};
+
+// CellList
+// The distinct board cells marked since the list was last cleared, in the
+// order they were first marked
+class CellList
+{
+public:
+    CellList() : m_width(0) {}
+    
+    // Sizes the list for a width x height board and clears it
+    void reset(int width, int height)
+    {
+        m_cells.clear();
+        m_width = width;
+        m_marked.assign(static_cast<std::size_t>(width) * height, 0);
+    }
+    
+    // (x, y) must be on the board
+    void mark(int x, int y)
+    {
+        std::size_t i = static_cast<std::size_t>(y) * m_width + x;
+        if (m_marked[i] != 0) return;
+        m_marked[i] = 1;
+        m_cells.push_back(std::make_pair(x, y));
+    }
+    
+    void clear()
+    {
+        for (const std::pair<int, int>& c : m_cells)
+            m_marked[static_cast<std::size_t>(c.second) * m_width + c.first] = 0;
+        m_cells.clear();
+    }
+    
+    const std::vector<std::pair<int, int> >& cells() const {return m_cells;}
+    
+private:
+    std::vector<std::pair<int, int> > m_cells;
+    std::vector<unsigned char> m_marked;  // row-major
+    int m_width;
+};
+
 class StudentWorld : public GameWorld
 {
 public:
-    StudentWorld(std::string assetPath);
+    StudentWorld(std::string assetPath,
+                 std::uint64_t seed,
+                 GraphObject::Registry& graphObjects = GraphObject::getGraphObjects());
     ~StudentWorld();
     virtual int init();
     virtual int move();
     virtual void cleanUp();
+    virtual const TileLayer* tileLayer() const {return &m_tiles;}
+    virtual void getViewOrigin(int& x, int& y) const;
+    GraphObject::Registry& graphObjects() const {return *m_graphObjects;}
+    int boardWidth() const {return m_tiles.width();}
+    int boardHeight() const {return m_tiles.height();}
     bool isBlocked(int x, int y) const;
     Player* player() const {return m_player;}
     bool isAt(Actor* ap, int x, int y) const;
@@ -22,19 +104,124 @@ public:
     void attackAt(int x, int y);
     bool freeFall(int x, int y) const;
     bool canClimb(int x, int y) const;
+    bool isWalkable(int x, int y) const;
     void addBarrel(int x, int y, int direction);
     void addBurp(int x, int y, int direction);
+    void relocate(Actor* ap, int fromX, int fromY);
+    void sleepUntil(Actor* ap, long long tick);
     void win() {m_win = true;}
+    bool readKey(int& value);
+    void setInput(InputSource* input) {m_input = input;}
+    bool startRecording(const std::string& path);
+    
+    // Plays width x height generated levels instead of the level files, each
+    // made from this world's seed and the level number; call it before the
+    // first init() and before startRecording()
+    void useGeneratedLevels(int width, int height);
+    int randInt(int min, int max) {return m_rng.randInt(min, max);}
+    void reseed(std::uint64_t seed) {m_seed = seed; m_rng.reseed(seed);}
+    std::uint64_t seed() const {return m_seed;}
+    long long tick() const {return m_tick;}
+    void saveSnapshot(WorldSnapshot& snapshot) const;
+    bool restoreSnapshot(const WorldSnapshot& snapshot);
     
 private:
     void updateDisplayText();
     bool clearDead();
+    bool inBounds(int x, int y) const;
+    void track(Actor* ap);
+    void untrack(Actor* ap, int x, int y);
+    bool isConsistent(const WorldSnapshot& snapshot) const;
+    void rebuildSchedule();
+    void runTurns();
+    void wakeAt(int x, int y);
+    void markCell(int x, int y);
+    void resolveContacts();
+    
+    // Visits every actor group, always in the same order; turns within a
+    // tick go by serial instead, see runTurns()
+    template <typename F>
+    void forEachGroup(F f)
+    {
+        f(m_kongs);
+        f(m_bonfires);
+        f(m_extraLifeGoodies);
+        f(m_garlicGoodies);
+        f(m_fireballs);
+        f(m_koopas);
+        f(m_barrels);
+        f(m_burps);
+    }
+    
+    template <typename F>
+    void forEachGroup(F f) const
+    {
+        const_cast<StudentWorld*>(this)->forEachGroup(f);
+    }
+    
+    // Where this world's actors register for display
+    GraphObject::Registry* m_graphObjects;
+    
+    // Compiled levels, mapped from the assets; closed when there is no catalog
+    LevelCatalog m_levels;
+    
+    // Loads the next level while this one is played; the current one is kept
+    // for restarting it after a death
+    LevelPrefetcher m_prefetcher;
+    std::unique_ptr<Level> m_level;
+    int m_levelNumber;
+    
+    // Floors and ladders, built from the Level maze in init()
+    TileLayer m_tiles;
+    
+    // Non-terrain actors bucketed by the chunk they occupy, kept current by
+    // relocate(), and how often each chunk is simulated, following the player
+    ChunkGrid m_chunks;
+    
+    // Cells something arrived in since the last pickup pass
+    CellList m_contactCells;
+    
+    // Actors waiting for a later tick; see sleepUntil()
+    TimerWheel m_timers;
+    
+    // Per-type storage for every actor; emptied wholesale in cleanUp()
+    ActorPool<Player> m_playerPool;
+    ActorGroup<Kong> m_kongs;
+    ActorGroup<Bonfire> m_bonfires;
+    ActorGroup<ExtraLifeGoodie> m_extraLifeGoodies;
+    ActorGroup<GarlicGoodie> m_garlicGoodies;
+    ActorGroup<Fireball> m_fireballs;
+    ActorGroup<Koopa> m_koopas;
+    ActorGroup<Barrel> m_barrels;
+    ActorGroup<Burp> m_burps;
     
-    std::vector<Actor*> m_actors;
     Player* m_player;
+    InputSource* m_input;
+    std::unique_ptr<ReplayRecorder> m_recorder;
+    std::uint64_t m_seed;
+    int m_mapWidth;         // 0 when playing the level files
+    int m_mapHeight;
+    Rng m_rng;
+    long long m_tick;       // move() calls over the world's lifetime
+    unsigned int m_nextSerial;
+    
+    // Scratch space for attackAt(), kept to avoid reallocating
+    std::vector<Actor*> m_targets;
+    
+    // Scratch space for snapshots, kept to avoid reallocating
+    mutable std::vector<std::pair<const Actor*, int> > m_snapshotIndex;
+    std::vector<Actor*> m_restored;
     bool m_win;
+    
+    // The stat line as last shown; see updateDisplayText()
+    bool m_hudValid;
+    int m_hudScore;
+    int m_hudLevel;
+    int m_hudLives;
+    int m_hudBurps;
+    char m_hudText[80];
 };
 
-std::string generate_stats(int score, int level, int livesLeft, int burps);
+void generate_stats(char* buffer, std::size_t size, int score, int level, int livesLeft, int burps);
 
 #endif // STUDENTWORLD_H_
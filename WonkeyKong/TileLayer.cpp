@@ -0,0 +1,79 @@
+#include "TileLayer.h"
+#include "Level.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+TileLayer::TileLayer()
+: m_width(0), m_height(0), m_words(0), m_revision(0)
+{
+    clear();
+}
+
+void TileLayer::build(const Level& lev)
+{
+    m_revision++;
+    m_width = lev.width();
+    m_height = lev.height();
+    m_words = (m_width + COLUMNS_PER_WORD - 1) / COLUMNS_PER_WORD;
+    m_floor.assign(static_cast<std::size_t>(m_words) * m_height, 0);
+    m_ladder.assign(m_floor.size(), 0);
+    for (int y = 0; y < m_height; y++)
+    {
+        for (int x = 0; x < m_width; x++)
+        {
+            RowMask bit = RowMask(1) << (x % COLUMNS_PER_WORD);
+            switch (lev.getContentsOf(x, y))
+            {
+                case Level::floor :
+                    m_floor[index(x / COLUMNS_PER_WORD, y)] |= bit;
+                    break;
+                case Level::ladder :
+                    m_ladder[index(x / COLUMNS_PER_WORD, y)] |= bit;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+void TileLayer::clear()
+{
+    m_revision++;
+    m_width = m_height = m_words = 0;
+    m_floor.clear();
+    m_ladder.clear();
+}
+
+TileLayer::RowMask TileLayer::spanMask(int w, int x0, int x1)
+{
+    int first = w * COLUMNS_PER_WORD;
+    int lo = x0 > first ? x0 - first : 0;
+    int hi = x1 - first;
+    if (hi < lo)
+        return 0;
+    
+    RowMask upTo = hi >= COLUMNS_PER_WORD - 1 ? ~RowMask(0) : (RowMask(1) << (hi + 1)) - 1;
+    return upTo & (~RowMask(0) << lo);
+}
+
+int TileLayer::lowestBit(RowMask row)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(row);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long bit;
+    _BitScanForward64(&bit, row);
+    return static_cast<int>(bit);
+#else
+    int bit = 0;
+    while ((row & 1) == 0)
+    {
+        row >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
@@ -0,0 +1,113 @@
+#ifndef TILELAYER_H_
+#define TILELAYER_H_
+
+#include "GameConstants.h"
+#include <cstdint>
+#include <vector>
+
+class Level;
+
+// TileLayer
+// Static terrain (floors and ladders) held as plain cell data instead of
+// Actor objects. It never moves, so it has no per-tick work and stays out of
+// the GraphObject registry. GameController::displayGamePlay() and the
+// headless SoftwareRenderer both reach it through GameWorld::tileLayer() and
+// draw it underneath the graph objects.
+//
+// Each row is stored as a bitboard, one 64-bit word per 64 columns with bit
+// x % 64 set for an occupied column, so a query about one cell is a shift and
+// a mask, and whole rows can be combined with a couple of word-wide
+// operations. The layer takes its size from the level it was built from.
+class TileLayer
+{
+public:
+    typedef std::uint64_t RowMask;
+    static const int COLUMNS_PER_WORD = 64;
+    
+    TileLayer();
+    
+    void build(const Level& lev);
+    void clear();
+    
+    int width() const {return m_width;}
+    int height() const {return m_height;}
+    
+    // Changes whenever build() or clear() does, so a renderer can keep the
+    // tiles' geometry until then
+    unsigned int revision() const {return m_revision;}
+    
+    bool isBlocked(int x, int y) const {return test(floorBits(x / COLUMNS_PER_WORD, y), x);}
+    bool canClimb(int x, int y) const {return test(ladderBits(x / COLUMNS_PER_WORD, y), x);}
+    bool isSupported(int x, int y) const {return test(supportedBits(x / COLUMNS_PER_WORD, y), x);}
+    bool isWalkable(int x, int y) const {return test(walkableBits(x / COLUMNS_PER_WORD, y), x);}
+    
+    // Row kernels, one word of row y at a time; word w holds columns
+    // 64w to 64w + 63, and rows outside the board are empty
+    RowMask floorBits(int w, int y) const {return rowValid(y) ? m_floor[index(w, y)] : 0;}
+    RowMask ladderBits(int w, int y) const {return rowValid(y) ? m_ladder[index(w, y)] : 0;}
+    
+    // Cells in row y that will not fall: a floor underneath, or a ladder here or underneath
+    RowMask supportedBits(int w, int y) const {return floorBits(w, y - 1) | ladderBits(w, y) | ladderBits(w, y - 1);}
+    
+    // Cells in row y an enemy can step onto without turning around
+    RowMask walkableBits(int w, int y) const {return supportedBits(w, y) & ~floorBits(w, y) & columnMask(w);}
+    
+    // Calls f(imageID, x, y) for every non-empty cell
+    template <typename F>
+    void forEachTile(F f) const
+    {
+        forEachTileIn(0, 0, m_width - 1, m_height - 1, f);
+    }
+    
+    // Calls f(imageID, x, y) for every non-empty cell with x0 <= x <= x1 and
+    // y0 <= y <= y1, so a renderer showing part of a large board only visits
+    // the rows and words it shows
+    template <typename F>
+    void forEachTileIn(int x0, int y0, int x1, int y1, F f) const
+    {
+        if (x0 < 0)
+            x0 = 0;
+        if (y0 < 0)
+            y0 = 0;
+        if (x1 >= m_width)
+            x1 = m_width - 1;
+        if (y1 >= m_height)
+            y1 = m_height - 1;
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int w = x0 / COLUMNS_PER_WORD; w <= x1 / COLUMNS_PER_WORD; w++)
+            {
+                RowMask span = spanMask(w, x0, x1);
+                for (RowMask row = m_floor[index(w, y)] & span; row != 0; row &= row - 1)
+                    f(IID_FLOOR, w * COLUMNS_PER_WORD + lowestBit(row), y);
+                for (RowMask row = m_ladder[index(w, y)] & span; row != 0; row &= row - 1)
+                    f(IID_LADDER, w * COLUMNS_PER_WORD + lowestBit(row), y);
+            }
+        }
+    }
+    
+private:
+    // Prevent copying or assigning TileLayers
+    TileLayer(const TileLayer&);
+    TileLayer& operator=(const TileLayer&);
+    
+    int m_width;
+    int m_height;
+    int m_words;                   // per row
+    std::vector<RowMask> m_floor;  // row-major, m_words per row
+    std::vector<RowMask> m_ladder;
+    unsigned int m_revision;
+    
+    bool rowValid(int y) const {return y >= 0 && y < m_height;}
+    std::size_t index(int w, int y) const {return static_cast<std::size_t>(y) * m_words + w;}
+    bool test(RowMask row, int x) const {return x >= 0 && x < m_width && ((row >> (x % COLUMNS_PER_WORD)) & 1) != 0;}
+    
+    // The columns of word w that are on the board
+    RowMask columnMask(int w) const {return spanMask(w, 0, m_width - 1);}
+    
+    // The columns of word w from x0 to x1
+    static RowMask spanMask(int w, int x0, int x1);
+    static int lowestBit(RowMask row);
+};
+
+#endif // TILELAYER_H_
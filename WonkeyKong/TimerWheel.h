@@ -0,0 +1,129 @@
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+#include "Actor.h"
+#include <vector>
+
+// TimerWheel
+// Wake-up ticks for actors that have nothing to do until then. Timers due
+// within the current block of 256 ticks sit in one slot per tick; those in
+// the next 63 blocks sit in one slot per block and are spread over the
+// fine slots when their block begins; anything further out waits in an
+// overflow list that is revisited every 16384 ticks. Which of these holds a
+// timer follows from its tick and the current one, and each actor records
+// its place in that slot, so scheduling, cancelling and firing are all
+// constant time. advance() must be called for every tick in turn. Each
+// actor has at most one timer, remembered by Actor::timerTick().
+class TimerWheel
+{
+public:
+    TimerWheel() : m_now(0) {}
+    
+    // Drops every timer and restarts the wheel at tick now
+    void clear(long long now)
+    {
+        for (std::vector<Actor*>& slot : m_inner)
+            release(slot);
+        for (std::vector<Actor*>& slot : m_outer)
+            release(slot);
+        release(m_overflow);
+        m_now = now;
+    }
+    
+    // tick must be later than the tick last advanced to
+    void schedule(Actor* ap, long long tick)
+    {
+        cancel(ap);
+        ap->setTimerTick(tick);
+        place(ap);
+    }
+    
+    void cancel(Actor* ap)
+    {
+        long long tick = ap->timerTick();
+        if (tick < 0) return;
+        ap->setTimerTick(-1);
+        
+        // Fill the gap with the slot's last timer
+        std::vector<Actor*>& slot = slotFor(tick);
+        std::size_t i = ap->timerIndex();
+        slot[i] = slot.back();
+        slot[i]->setTimerIndex(i);
+        slot.pop_back();
+    }
+    
+    // Moves to the next tick and calls fire(ap) for every timer due on it,
+    // after taking them all off the wheel
+    template <typename F>
+    void advance(long long now, F fire)
+    {
+        m_now = now;
+        if ((now & INNER_MASK) == 0)
+        {
+            if ((now & ((1 << (INNER_BITS + OUTER_BITS)) - 1)) == 0)
+                cascade(m_overflow);
+            cascade(m_outer[(now >> INNER_BITS) & OUTER_MASK]);
+        }
+        
+        std::vector<Actor*>& slot = m_inner[now & INNER_MASK];
+        m_firing.swap(slot);
+        for (Actor* ap : m_firing)
+            ap->setTimerTick(-1);
+        for (Actor* ap : m_firing)
+            fire(ap);
+        m_firing.clear();
+        m_firing.swap(slot);
+    }
+    
+private:
+    static const int INNER_BITS = 8;
+    static const int OUTER_BITS = 6;
+    static const long long INNER_MASK = (1 << INNER_BITS) - 1;
+    static const long long OUTER_MASK = (1 << OUTER_BITS) - 1;
+    
+    // The slot a timer due on tick sits in at the current tick. advance()
+    // cascades each block's timers before that block's first tick fires, so
+    // this holds for every timer on the wheel between calls.
+    std::vector<Actor*>& slotFor(long long tick)
+    {
+        if ((tick >> INNER_BITS) == (m_now >> INNER_BITS))
+            return m_inner[tick & INNER_MASK];
+        else if ((tick >> (INNER_BITS + OUTER_BITS)) == (m_now >> (INNER_BITS + OUTER_BITS)))
+            return m_outer[(tick >> INNER_BITS) & OUTER_MASK];
+        return m_overflow;
+    }
+    
+    void place(Actor* ap)
+    {
+        std::vector<Actor*>& slot = slotFor(ap->timerTick());
+        ap->setTimerIndex(slot.size());
+        slot.push_back(ap);
+    }
+    
+    void cascade(std::vector<Actor*>& from)
+    {
+        m_firing.swap(from);
+        for (Actor* ap : m_firing)
+            place(ap);
+        m_firing.clear();
+    }
+    
+    static void release(std::vector<Actor*>& slot)
+    {
+        for (Actor* ap : slot)
+            ap->setTimerTick(-1);
+        slot.clear();
+    }
+    
+    // Prevent copying or assigning TimerWheels
+    TimerWheel(const TimerWheel&);
+    TimerWheel& operator=(const TimerWheel&);
+    
+    std::vector<Actor*> m_inner[1 << INNER_BITS];
+    std::vector<Actor*> m_outer[1 << OUTER_BITS];
+    std::vector<Actor*> m_overflow;
+    std::vector<Actor*> m_firing;   // scratch, so slots keep their capacity
+    long long m_now;
+};
+
+#endif // TIMERWHEEL_H_